@@ -124,6 +124,8 @@ typedef struct { /* summary totals */
 	int	n_unalloc;		/* number of unallocated chunks */
 } totals_rec, *totals_ptr;
 
+static progress_ptr progress; /* dst sectors examined, for user feedback */
+
 
 /******************************************************************************
 Examine a part of the destination disk that does not correspond to any area
@@ -175,7 +177,7 @@ Loop to scan dst_n sectors from common up to common + dst_n
 ******************************************************************************/
 	dst_lba = common;
 	for (lba = common; lba < dst_n; lba++) {
-		feedback (start_time,0,dst_lba,n_sectors(dst_disk));
+		progress_add (progress,1);
 		dst_status = read_lba(dst_disk,dst_lba++,&dst_buff);
 		if (dst_status) {
 			fprintf (log,"dst read error 0x%02X on track starting at lba %llu\n",dst_status,dst_lba-1);
@@ -287,7 +289,7 @@ int cmp_region (FILE *log, /* the log file */
 		src_lba,dst_lba);
 	for (lba = 0; lba < common;lba++) { /* main loop: scan sectors that correspond */
 		is_diff = 0;
-		feedback(start_time,0,dst_lba,n_sectors(dst_disk));
+		progress_add (progress,1);
 		src_status = read_lba(src_disk,src_lba++,&src_buff);
 		dst_status = read_lba(dst_disk,dst_lba++,&dst_buff);
 		if (src_status) {
@@ -726,6 +728,7 @@ void print_help(char *p /* the program name */)
 	printf ("-layout\tPrint disk layout only (no compare)\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse different log file (default is cmpalog.txt)\n");
+	printf ("-table <file>\tUse partition tables saved by partab -table\n");
 	printf ("-assign \tAssign corresponding regions between src and dst via dialog\n");
 	printf ("-h\tPrint this option list\n");
 }
@@ -757,7 +760,8 @@ main (int np, char **p)
 	int		dst_n_regions = 0;
 	layout_ptr	dst_layout = (layout_ptr) malloc(MAX_PARTITIONS*sizeof(layout_rec));
 
-	FILE		*log; /* log file */
+	FILE		*log, /* log file */
+			*table = NULL; /* saved partition tables */
 	char		comment [NAME_LENGTH] = "",
 			log_name[NAME_LENGTH] = "cmpalog.txt",
 			access[2] = "a"; /* tester (user) comment for log file */
@@ -790,7 +794,13 @@ Get command line
 		else if (strcmp (p[i], "-h") == 0) help = 1;
 		else if (strcmp (p[i], "-layout") == 0) layout_only = 1;
 		else if (strcmp (p[i], "-new_log")== 0) access[0] = 'w';
-		else if (strcmp (p[i], "-log_name") == 0) {
+		else if (strcmp (p[i], "-table") == 0) {
+			if(++i >= np) {
+				printf("%s: -table option requires a file name\n", p[0]);
+				help = 1;
+			} else if ((table = fopen (p[i],"r")) == NULL)
+				printf ("%s: could not open partition table file %s\n", p[0], p[i]);
+		} else if (strcmp (p[i], "-log_name") == 0) {
 			if(++i >= np) {
 				printf("%s: -log_name option requires a logfile name\n", p[0]);
 				help = 1;
@@ -826,6 +836,8 @@ Start log file, open source disk and get partition table
 		return 1;
 	}
 	log_disk (log,"Source Disk",src_dcb);
+	if (table && (load_partition_table(table,src_dcb) == 0))
+		fprintf (log,"Source partition table from saved table\n");
 	status = get_partition_table(src_dcb,src_pt);
 
 	if (status == 0) {
@@ -877,6 +889,9 @@ Open destination disk, get partition table
 		return 1;
 	}
 	log_disk (log,"Destination Disk",dst_dcb);
+	if (table) rewind (table);
+	if (table && (load_partition_table(table,dst_dcb) == 0))
+		fprintf (log,"Destination partition table from saved table\n");
 	status = get_partition_table(dst_dcb,dst_pt);
 	if (status == 0){
 		fprintf (log,"Destination disk partition table\n");
@@ -919,9 +934,12 @@ Open destination disk, get partition table
 /******************************************************************************
 Do the compare
 ******************************************************************************/
-	if (layout_only == 0)
+	if (layout_only == 0) {
+		progress = progress_start ("",0,n_sectors(dst_dcb));
 		status = do_compare(src_dcb,src_n_regions,src_layout,dst_dcb,dst_n_regions,
 					dst_layout,src_fill,dst_fill,log,assign_regions,from);
+		progress_end (progress);
+	}
 /******************************************************************************
 Close the log file
 ******************************************************************************/
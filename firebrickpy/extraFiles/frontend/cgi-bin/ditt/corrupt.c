@@ -30,11 +30,14 @@ static char *SCCS_ID[] = {"@(#) corrupt.c Linux Version 1.2 Created 02/18/05 at
 # include <unistd.h>
 # include <stdio.h>
 # include "zbios.h"
+# include "zhash.h"
 # include <time.h>
 # include <string.h>
 # include <malloc.h>
+# include <stdlib.h>
 # include <fcntl.h>
 # include <errno.h>
+# include <ctype.h>
 /*****************************************************************
 Corrupt an image file
 CORRUPT is used to corrupt an image file by changing a
@@ -43,15 +46,46 @@ CORRUPT logs the original content of the selected byte,
 the replacement value, the offset of the byte within the file and
 the file name.
 
+With -manifest (a segment manifest of the image, see diskhash) the
+segment holding the byte is logged too, and written to the -seg_list
+file so that hashver -seg_list re-hashes just that segment to check
+the change is found, instead of the whole image.
+
+Campaign mode changes many bytes in one run, to stress verifiers and
+the compare tools: in place of offset and hex_value give
+	-list <name>	a file of lines "offset [hex_value]"; with no
+			value the byte is inverted
+	-random <seed> <count> <uniform|cluster>
+			count offsets drawn from seed, anywhere in the
+			file (uniform) or in runs of up to CLUSTER_RUN
+			within CLUSTER_SPAN bytes of each other
+			(cluster), each byte changed to a different value
+The changes are made in offset order (a repeated offset only once,
+as first listed)
+with the file open once and one sync at the end, then read back. Each
+change gets a log line, then a summary. The generator is our own so
+that a seed gives the same offsets on any host.
+
 program outline
 	get command line
+	get the changes: one, a list, or random; sort them
 	open the file
-	read byte to change
-	write back new value
-	read back to confirm
-	log results
+	read the bytes to change and write the new values
+	sync, then read back to confirm
+	log results (and the segments touched)
 
 *****************************************************************/
+# define CLUSTER_RUN	8	/* most changes around one spot */
+# define CLUSTER_SPAN	4096	/* ... within this many bytes */
+
+typedef struct {
+	off_t		at; /* file offset (location) to make change */
+	int		value, /* replacement, or -1 to pick one from old */
+			order; /* place in the list, first wins if repeated */
+	unsigned char	old_char, /* the char originally in the file */
+			new_char, /* the replacement character */
+			verify_char; /* after writting, read the char back to make sure */
+} change;
 
 void print_help(char *p) {
 	static int been_here = 0;
@@ -59,36 +93,172 @@ void print_help(char *p) {
 	been_here = 1;
 
 	printf ("Usage: %s test-case host operator file_name offset hex_value [-options]\n",p);
+	printf ("   or: %s test-case host operator file_name -list <name> | -random <seed> <count> <dist> [-options]\n",p);
+	printf ("-list <name>\tMake the changes listed in <name>, lines of: offset [hex_value]\n");
+	printf ("-random <seed> <count> <dist>\tMake count changes at random offsets, dist is uniform or cluster\n");
 	printf ("-comment \" ... \"\tGive comment on command line\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse different log file (default is corlog.txt)\n");
+	printf ("-manifest <name>\tLog the segment of manifest <name> changed\n");
+	printf ("-seg_list <name>\tWrite the segments changed to <name> (default is corseg.txt)\n");
 	printf ("-h\tPrint this option list\n");
 }
 
+/*****************************************************************
+Next number from a 64 bit xorshift* generator with state *s
+*****************************************************************/
+unsigned long long next_random (unsigned long long *s)
+{
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 2685821657736338717ULL;
+}
+
+/*****************************************************************
+Order changes by offset, then as listed
+*****************************************************************/
+int by_at (const void *a, const void *b)
+{
+	off_t	x = ((change *) a)->at,
+		y = ((change *) b)->at;
+
+	if (x != y) return x < y ? -1 : 1;
+	return ((change *) a)->order - ((change *) b)->order;
+}
+
+/*****************************************************************
+Read the changes listed in file name
+	returns the changes and sets *n, or NULL if the file can
+	not be read or a line is not valid
+*****************************************************************/
+change *load_changes (char *name, int *n)
+{
+	FILE		*f;
+	change		*c = NULL;
+	char		line[NAME_LENGTH];
+	unsigned long long at;
+	unsigned int	value;
+	int		k,
+			end,
+			end_at,
+			end_value,
+			max = 0,
+			line_no = 0;
+
+	*n = 0;
+	f = fopen (name,"r");
+	if (f == NULL) {
+		printf ("Could not open change list %s\n",name);
+		return NULL;
+	}
+	while (fgets (line,NAME_LENGTH,f)) {
+		line_no++;
+		/* an offset, an optional hex value, then only white space */
+		end_at = end_value = 0;
+		k = sscanf (line," %llu%n %X%n",&at,&end_at,&value,&end_value);
+		if (!isdigit (line[strspn (line," \t")])) k = 0;
+		if (k == 2 && value > 0xFF) k = 0; /* as for a single change */
+		end = k == 2 ? end_value : end_at;
+		if (k >= 1 && strspn (line + end," \t\r\n") != strlen (line + end)) k = 0;
+		if (k < 1) {
+			if (strspn (line," \t\r\n") == strlen (line)) continue;
+			printf ("%s line %d is not: offset [hex_value 00 to FF]\n",name,line_no);
+			free (c);
+			fclose (f);
+			return NULL;
+		}
+		if (*n == max) {
+			max = max ? 2*max : 1024;
+			c = (change *) realloc (c,max*sizeof(change));
+			if (c == NULL) {
+				printf ("Unable to allocate memory!\n");
+				fclose (f);
+				return NULL;
+			}
+		}
+		c[*n].at = at;
+		c[*n].value = k == 2 ? value : -1;
+		(*n)++;
+	}
+	fclose (f);
+	return c;
+}
+
+/*****************************************************************
+Draw n changes from seed in a file of size bytes
+	dist -- "uniform" or "cluster"
+	returns the changes, or NULL
+*****************************************************************/
+change *random_changes (unsigned long long seed, int n, char *dist, off_t size)
+{
+	change			*c;
+	unsigned long long	s = seed ? seed : 1,
+				base = 0;
+	off_t			span = size < CLUSTER_SPAN ? size : CLUSTER_SPAN;
+	int			i,
+				cluster = strcmp (dist,"cluster") == 0;
+
+	c = (change *) malloc (n*sizeof(change));
+	if (c == NULL) return NULL;
+	for (i = 0; i < n; i++) {
+		if (!cluster) c[i].at = next_random (&s) % size;
+		else {
+			if (i % CLUSTER_RUN == 0) base = next_random (&s) % (size - span + 1);
+			c[i].at = base + next_random (&s) % span;
+		}
+		c[i].value = -1;
+	}
+	return c;
+}
+
 # define ERR -1
 main (int np, char **p) {
 	int		help = 0,
 			i, /* loop index */
-			f; /* file descriptor */
-	int		status; /* return code for read/write operations */
+			j,
+			f, /* file descriptor */
+			first_option = 7,
+			n = 1, /* number of changes */
+			n_repeat = 0, /* repeated offsets dropped */
+			n_bad = 0, /* changes that did not read back */
+			n_made, /* changes written */
+			n_segs = 0,
+			count = 0,
+			campaign = 0;
+	int		status, /* return code for read/write operations */
+			seg = -1, /* segment of the manifest changed */
+			last_seg;
 	static time_t	from; /* start time */
-	FILE		*log; /* the log file */
+	FILE		*log, /* the log file */
+			*f_man, /* the manifest */
+			*f_list = NULL; /* segment list for hashver */
+	hash_manifest_ptr m = NULL; /* manifest of the image */
 	static char	comment[NAME_LENGTH] = "",
 			log_name[NAME_LENGTH] = "corlog.txt",
+			manifest_name[NAME_LENGTH] = "",
+			seg_list[NAME_LENGTH] = "corseg.txt",
+			list_name[NAME_LENGTH] = "",
+			dist[NAME_LENGTH] = "",
 			access[2] = "a";
-	off_t		at, /* file offset (location) to make change */
-			seek_return; /* return value from seek call */
-	unsigned char	old_char = 'a', /* the char originally in the file */
-			new_char = 'Z', /* the replacement character */
-			verify_char = '0'; /* after writting, read the char back to make sure */
+	off_t		size; /* file size */
+	change		one,
+			*c = &one; /* the changes */
+	unsigned int	value; /* new_char as scanned (%X needs an int) */
+	unsigned long long seed = 0,
+			rnd = 0;
 
 	time(&from);
 	printf ("\n%s compiled at %s on %s\n", p[0],
 		__TIME__,__DATE__);
 
 		/* get the command line */
-	if (np < 7) help = 1;
-	for (i = 7; i < np; i++) {
+	if (np > 5 && p[5][0] == '-') {
+		campaign = 1;
+		first_option = 5;
+	}
+	if (np < first_option) help = 1;
+	for (i = first_option; i < np; i++) {
 		if (strcmp (p[i],"-h") == 0) {help = 1; break;}
 		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
 		else if (strcmp (p[i], "-log_name") == 0) {
@@ -102,85 +272,179 @@ main (int np, char **p) {
 				printf ("%s: -comment option requires a comment\n",p[0]);
 				help = 1;
 			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		} else if (strcmp (p[i],"-manifest")== 0) {
+			if(++i >= np) {
+				printf("%s: -manifest option requires a manifest name\n", p[0]);
+				help = 1;
+			} else strncpy(manifest_name, p[i], NAME_LENGTH - 1);
+		} else if (strcmp (p[i],"-seg_list")== 0) {
+			if(++i >= np) {
+				printf("%s: -seg_list option requires a file name\n", p[0]);
+				help = 1;
+			} else strncpy(seg_list, p[i], NAME_LENGTH - 1);
+		} else if (campaign && strcmp (p[i],"-list")== 0) {
+			if(++i >= np) {
+				printf("%s: -list option requires a file name\n", p[0]);
+				help = 1;
+			} else strncpy(list_name, p[i], NAME_LENGTH - 1);
+		} else if (campaign && strcmp (p[i],"-random")== 0) {
+			if (i + 3 >= np || sscanf (p[i+1],"%llu",&seed) != 1
+					|| sscanf (p[i+2],"%d",&count) != 1 || count < 1
+					|| (strcmp (p[i+3],"uniform") && strcmp (p[i+3],"cluster"))) {
+				printf("%s: -random option requires a seed, a count and uniform or cluster\n", p[0]);
+				help = 1;
+			} else strncpy(dist, p[i+3], NAME_LENGTH - 1);
+			i += 3;
 		} else {
 			printf("Invalid parameter: %s\n", p[i]);
 			help = 1;
 		}
 	}
+	if (!help && campaign && !list_name[0] == !dist[0]) {
+		printf ("%s: give an offset and value, -list or -random\n",p[0]);
+		help = 1;
+	}
 	if (help){
 		print_help(p[0]);
 		return 0;
 	}
+	/* read the manifest before anything is changed */
+	if (manifest_name[0]) {
+		f_man = fopen (manifest_name,"r");
+		if (f_man == NULL || (m = manifest_read (f_man)) == NULL) {
+			printf ("%s: %s is not a segment manifest\n",p[0],manifest_name);
+			return 1;
+		}
+		fclose (f_man);
+	}
 	/* open the file named in p[4] */
 	f = open (p[4],O_RDWR);
 	if (f == ERR){
 		printf ("%s: Open %s failed with error %i (%s)\n",p[0],p[4],errno,strerror(errno));
 		return 1;
 	}
-	/* get the offset value */
-	status = sscanf (p[5],"%llu",&at);
-	if (status != 1){
-		printf ("%s: Offset value (%s) is not valid\n",p[0],p[5]);
+	size = lseek (f,0,SEEK_END);
+	if (size <= 0){
+		printf ("%s: %s is empty or its size can not be found\n",p[0],p[4]);
 		return 1;
 	}
-	/* get the replacement character */
-	status = sscanf (p[6],"%02X",&new_char);
-	if (status != 1){
-		printf ("%s: Replacement value (%s) is not valid\n",p[0],p[6]);
-		return 1;
-	}
-	/* position to read from the offset */
-	seek_return = lseek (f,at,SEEK_SET);
-	if (seek_return == ERR){
-		printf ("%s: Offset %llu is not valid for %s\n",p[0],at,p[4]);
-		printf("Error: %i (%s)\n", errno, strerror(errno));
-		return 1;
+	/* get the changes */
+	if (list_name[0]) c = load_changes (list_name,&n);
+	else if (dist[0]) {
+		n = count;
+		c = random_changes (seed,n,dist,size);
+		rnd = seed ^ 0x9E3779B97F4A7C15ULL;
+	} else {
+		/* get the offset value */
+		status = sscanf (p[5],"%llu",&one.at);
+		if (status != 1){
+			printf ("%s: Offset value (%s) is not valid\n",p[0],p[5]);
+			return 1;
+		}
+		/* get the replacement character */
+		status = sscanf (p[6],"%X",&value);
+		if (status != 1 || value > 0xFF){
+			printf ("%s: Replacement value (%s) is not valid\n",p[0],p[6]);
+			return 1;
+		}
+		one.value = value;
 	}
-	/* read the current contents */
-	status = read (f,&old_char,1);
-	if (status != 1){
-		printf ("%s: Read failed\n",p[0]);
+	if (c == NULL || n == 0){
+		printf ("%s: no changes to make\n",p[0]);
 		return 1;
 	}
-	/* reset the file position */
-	seek_return = lseek (f,at,SEEK_SET);
-	if (seek_return == ERR){
-		printf ("%s: Seek to %llu on %s after read failed\n\n",p[0],at,p[4]);
-		return 1;
+	for (i = 0; i < n; i++) c[i].order = i;
+	qsort (c,n,sizeof(change),by_at);
+	for (i = j = 0; i < n; i++) {
+		if (c[i].at < 0 || c[i].at >= size){
+			printf ("%s: Offset %llu is not valid for %s\n",p[0],c[i].at,p[4]);
+			return 1;
+		}
+		if (j && c[i].at == c[j-1].at) n_repeat++;
+		else c[j++] = c[i];
 	}
-	/* write the new (replacement) value */
-	status = write (f,&new_char,1);
-	if (status != 1){
-		printf ("%s: Write failed\n",p[0]);
-		return 1;
+	n = j;
+	/* log each change as it is made, so that a run stopped part way
+	   still says which bytes it changed and what they were */
+	log = log_open(log_name,access,comment,SCCS_ID,np,p);
+	if (m) f_list = fopen (seg_list,"w");
+	last_seg = -1;
+	/* read the current contents and write the new (replacement) values */
+	for (n_made = 0; n_made < n; n_made++) {
+		i = n_made;
+		status = pread (f,&c[i].old_char,1,c[i].at);
+		if (status != 1){
+			printf ("%s: Read at %llu failed\n",p[0],c[i].at);
+			fprintf (log,"Read at %llu failed\n",c[i].at);
+			break;
+		}
+		if (c[i].value >= 0) c[i].new_char = c[i].value;
+		else if (dist[0]) /* any other value */
+			c[i].new_char = c[i].old_char ^ (1 + next_random (&rnd) % 255);
+		else c[i].new_char = ~c[i].old_char;
+		status = pwrite (f,&c[i].new_char,1,c[i].at);
+		if (status != 1){
+			printf ("%s: Write at %llu failed\n",p[0],c[i].at);
+			fprintf (log,"Write at %llu failed\n",c[i].at);
+			break;
+		}
+		fprintf (log,"Change byte %llu of file %s from 0x%02X to 0x%02X",
+			c[i].at,p[4],c[i].old_char,c[i].new_char);
+		if (m && (seg = seg_of (m,c[i].at/BYTES_PER_SECTOR)) >= 0) {
+			if (campaign) fprintf (log," segment %d",seg);
+			/* sorted, so each segment comes in one run */
+			if (seg != last_seg) {
+				n_segs++;
+				if (f_list) fprintf (f_list,"%d\n",seg);
+			}
+			last_seg = seg;
+		}
+		fprintf (log,"\n");
+		if (!campaign)
+			printf ("Change byte %llu of file %s from 0x%02X to 0x%02X\n",
+				c[i].at,p[4],c[i].old_char,c[i].new_char);
 	}
 	/* Commit data to file */
 	status = mysync(f);
-	/* reset the file position */
-	seek_return = lseek (f,at,SEEK_SET);
-	if (seek_return == ERR){
-		printf ("%s: Seek to %llu on %s after write failed\n",p[0],at,p[4]);
-		return 1;
-	}
 	/* read back what was written */
-	status = read (f,&verify_char,1);
-	if (status != 1){
-		printf ("%s: Verify read failed\n",p[0]);
-		return 1;
-	}
-	/* Verify match */
-	if (verify_char != new_char){
-		printf ("%s: verify failed: char read back (0x%02X) should be (0x%02x)\n",
-			p[0],old_char,new_char);
-		return 1;
+	for (i = 0; i < n_made; i++) {
+		status = pread (f,&c[i].verify_char,1,c[i].at);
+		if (status != 1){
+			printf ("%s: Verify read at %llu failed\n",p[0],c[i].at);
+			fprintf (log,"Verify read at %llu failed\n",c[i].at);
+			n_bad++;
+		} else if (c[i].verify_char != c[i].new_char){
+			/* Verify match */
+			printf ("%s: verify failed at %llu: char read back (0x%02X) should be (0x%02x)\n",
+				p[0],c[i].at,c[i].verify_char,c[i].new_char);
+			fprintf (log,"Byte %llu reads back 0x%02X, not 0x%02X\n",
+				c[i].at,c[i].verify_char,c[i].new_char);
+			n_bad++;
+		}
 	}
-	 /* ran OK, so log results */
-	log = log_open(log_name,access,comment,SCCS_ID,np,p);
+	close (f);
 
-	fprintf (log,"Change byte %llu of file %s from 0x%02X to 0x%02X\n",
-		at,p[4],old_char,new_char);
-	printf ("Change byte %llu of file %s from 0x%02X to 0x%02X\n",
-		at,p[4],old_char,new_char);
+	if (m && !campaign && n_made) {
+		if (seg < 0) fprintf (log,"Byte %llu is outside manifest %s (lba %llu through %llu)\n",
+			c[0].at,manifest_name,m->first,m->first + m->n_sectors - 1);
+		else fprintf (log,"Segment %d (lba %llu through %llu) of manifest %s changed\n",
+			seg,seg_first(m,seg),seg_first(m,seg) + seg_length(m,seg) - 1,manifest_name);
+	}
+	if (m && f_list == NULL) fprintf (log,"Could not write segment list %s\n",seg_list);
+	else if (f_list) fclose (f_list);
+	if (campaign) {
+		if (dist[0]) fprintf (log,"Random changes: seed %llu, %d %s\n",seed,count,dist);
+		else fprintf (log,"Changes listed in %s\n",list_name);
+		if (n_made) fprintf (log,"%d bytes of %s changed from byte %llu through %llu, %d repeated offsets dropped\n",
+			n_made,p[4],c[0].at,c[n_made-1].at,n_repeat);
+		if (m) fprintf (log,"%d segments of manifest %s changed\n",n_segs,manifest_name);
+		if (n_bad) fprintf (log,"%d changes did NOT read back\n",n_bad);
+		printf ("%d bytes of %s changed%s\n",n_made,p[4],n_bad ? ", some did NOT read back" : "");
+	}
+	if (n_made < n) {
+		fprintf (log,"Stopped after %d of %d changes\n",n_made,n);
+		printf ("%s: stopped after %d of %d changes\n",p[0],n_made,n);
+	}
 	log_close (log,from);
-	return 0;
+	return n_made < n || n_bad ? 1 : 0;
 }
@@ -32,6 +32,7 @@ static char *SCCS_ID[] = {"@(#) diskcmp.c Linux Version 1.2 Created 02/18/05 at
 # include <string.h>
 # include <time.h>
 # include <malloc.h>
+# include <stdlib.h>
 
 /*****************************************************************
 Compare two disks
@@ -55,8 +56,87 @@ High level design:
 		examine: count zero filled, src filled, dst filled, other filled and
 			not filled sectors
 	log results
+
+Quick mode (-quick) only answers "are the two disks the same?": the
+compare stops at the first block that differs or can not be read and
+the exit status gives the answer (see CMP_EQUAL ... CMP_IO_ERROR).
 *****************************************************************/
 
+/* exit status for -quick */
+# define CMP_EQUAL	0 /* every sector matches */
+# define CMP_DIFFER	1 /* at least one sector differs */
+# define CMP_SIZE	2 /* disks are not the same size */
+# define CMP_IO_ERROR	3 /* a disk could not be opened or read */
+
+# define QUICK_BLOCK 8192 /* sectors per read in quick mode (4 MB) */
+
+/*****************************************************************
+Quick compare: read both disks QUICK_BLOCK sectors at a time and
+stop at the first block that does not match
+*****************************************************************/
+int quick_cmp (disk_control_ptr src_disk, disk_control_ptr dst_disk,
+	time_t from, FILE *log)
+{
+	unsigned char	*sb, *db; /* block buffers */
+	off_t		lba, /* first sector of current block */
+			k, /* sectors in current block */
+			ns = n_sectors(src_disk);
+	int		i,
+			src_status,
+			dst_status,
+			status = CMP_EQUAL;
+	progress_ptr	progress;
+
+	if (ns != n_sectors(dst_disk)) {
+		fprintf (log,"Quick compare: size mismatch: source %llu sectors, destination %llu sectors\n",
+			ns, n_sectors(dst_disk));
+		printf ("Size mismatch: source %llu sectors, destination %llu sectors\n",
+			ns, n_sectors(dst_disk));
+		return CMP_SIZE;
+	}
+	sb = (unsigned char *) malloc (QUICK_BLOCK*BYTES_PER_SECTOR);
+	db = (unsigned char *) malloc (QUICK_BLOCK*BYTES_PER_SECTOR);
+	if ((sb == NULL) || (db == NULL)) {
+		printf ("Unable to allocate memory!\n");
+		free (sb);
+		free (db);
+		return CMP_IO_ERROR;
+	}
+	progress = progress_start ("",0,ns);
+	for (lba = 0; lba < ns; lba += k) {
+		k = ns - lba;
+		if (k > QUICK_BLOCK) k = QUICK_BLOCK;
+		src_status = read_sectors (src_disk, lba, k, sb);
+		dst_status = read_sectors (dst_disk, lba, k, db);
+		if (src_status || dst_status) {
+			fprintf (log,"Quick compare: %s read error 0x%02X in block at lba %llu\n",
+				src_status ? "src" : "dst", src_status ? src_status : dst_status, lba);
+			printf ("%s read error in block at lba %llu\n",
+				src_status ? "src" : "dst", lba);
+			status = CMP_IO_ERROR;
+			break;
+		}
+		if (memcmp (sb, db, k*BYTES_PER_SECTOR)) {
+			for (i = 0; i < k; i++) /* find the first sector that differs */
+				if (memcmp (sb + i*BYTES_PER_SECTOR, db + i*BYTES_PER_SECTOR,
+					BYTES_PER_SECTOR)) break;
+			fprintf (log,"Quick compare: disks differ at sector %llu\n", lba + i);
+			printf ("Disks differ at sector %llu\n", lba + i);
+			status = CMP_DIFFER;
+			break;
+		}
+		progress_add (progress,k);
+	}
+	progress_end (progress);
+	if (status == CMP_EQUAL) {
+		fprintf (log,"Quick compare: %llu sectors, disks are the same\n", ns);
+		printf ("Disks are the same\n");
+	}
+	free (sb);
+	free (db);
+	return status;
+}
+
 void print_help(char *p) {
 	static int been_here = 0;
 	if (been_here) return;
@@ -64,6 +144,7 @@ void print_help(char *p) {
 
 	printf ("Usage: %s test-case host operator src-drive src-fill dst-drive dst-fill [-options]\n",p);
 	printf ("-comment \" ... \"\tDescriptive comment\n");
+	printf ("-quick\tStop at the first difference; exit status 0 same, 1 differ,\n\t2 size mismatch, 3 I/O error\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse different log file (default is cmplog.txt)\n");
 	printf ("-h\tPrint this option list\n");
@@ -99,8 +180,10 @@ main (int np, char **p) {
 	static unsigned char *src_buff,
 			*dst_buff; /* current src and dst sector data */
 	static time_t	from; /* program start time */
+	progress_ptr	progress; /* sectors examined, for user feedback */
 	FILE		*log;  /* the log file */
-	int		is_debug = 0;
+	int		is_debug = 0,
+			is_quick = 0;
 	unsigned char	other_fill_char,
 			src_fill_char,
 			dst_fill_char; /* the fill characters */
@@ -145,6 +228,7 @@ Get the command line
 	for (i = 8; i < np; i++) { /* optional parameters */
 		if (strcmp (p[i],"-h") == 0) help = 1;
 		else if (strcmp (p[i],"-debug")== 0) is_debug = 1;
+		else if (strcmp (p[i],"-quick")== 0) is_quick = 1;
 		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
 		else if (strcmp (p[i], "-log_name") == 0) {
 			if(++i >= np) {
@@ -175,7 +259,7 @@ Start log file
 			p[0],src_drive,status);
 		fprintf (log,"%s could not access src drive %s status code %d\n",
 			p[0],src_drive,status);
-		return 1;
+		return is_quick ? CMP_IO_ERROR : 1;
 	}
 	log_disk(log,"Source",src_disk);
 	dst_disk = open_disk (dst_drive,&status);
@@ -184,9 +268,14 @@ Start log file
 			p[0],dst_drive,status);
 		fprintf (log,"%s could not access dst drive %s status code %d\n",
 			p[0],dst_drive,status);
-		return 1;
+		return is_quick ? CMP_IO_ERROR : 1;
 	}
 	log_disk(log,"Destination",dst_disk);
+	if (is_quick) {
+		status = quick_cmp (src_disk,dst_disk,from,log);
+		log_close(log,from);
+		return status;
+	}
 	src_ns = n_sectors(src_disk);
 	dst_ns = n_sectors(dst_disk);
 
@@ -204,9 +293,10 @@ Start log file
 /*****************************************************************
 Main scan loop: read corresponding sectors and compare
 *****************************************************************/
+	progress = progress_start ("",0,big_dst?dst_ns:common);
 	for (lba = 0; lba < common; is_debug?(lba+=100):lba++){
 		is_diff = 0;
-		feedback (from,0,lba,big_dst?dst_ns:common);
+		progress_add (progress,1);
 		src_status = read_lba(src_disk,lba,&src_buff);
 		dst_status = read_lba(dst_disk,lba,&dst_buff);
 		if (src_status) { /* if bad sectors, keep list of first 10 */
@@ -272,7 +362,7 @@ Main scan loop: read corresponding sectors and compare
 		printf ("Destination larger than source; scanning %llu sectors\n",
 			dst_ns-common);
 		for (lba = common; lba < dst_ns; is_debug?(lba+=100):lba++){
-			feedback (from,0,lba,dst_ns);
+			progress_add (progress,1);
 			dst_status = read_lba(dst_disk,lba,&dst_buff);
 			if (dst_status){
 				n_dst_err++;
@@ -330,6 +420,7 @@ Main scan loop: read corresponding sectors and compare
 		print_range_list (log,"Other fill range: ",of_r);
 		print_range_list (log,"Other not filled range: ",o_r);
 	}
+	progress_end (progress);
 	fprintf (log,"%llu source read errors, %llu destination read errors\n",
 		n_src_err,n_dst_err);
 
@@ -0,0 +1,520 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) diskhash.c Linux Version 2.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <sys/utsname.h>
+/*****************************************************************
+Hash whole disks
+DISKHASH reads a disk once and computes its MD5, SHA-1 and SHA-256
+at the same time, each digest on its own thread from the same read
+buffers (see hash_disk in zhash.c). It replaces diskhash.csh, which
+piped dd bs=512 into one hash program per pass, and logs the same
+fields: case, host, user, device, label, comment, the hash, the
+system, the disk and the run times. The digest selected by -hash
+(default sha1sum, as diskhash.csh) is also logged on its own in the
+old "HASH  -" form.
+
+Sectors that can not be read are hashed as zeroes and logged.
+
+With -manifest the -hash digest of each segment of the disk is also
+kept and written to a manifest file (see hash_manifest in zhash.h) for
+hashver to check a disk or image against later, a segment at a time.
+
+With -tree the -hash digest is also computed as a tree hash (see
+hash_tree in zhash.h): a pool of threads (-threads, default one per
+CPU) hashes 1 MB leaves from the same reads, and the root goes in the
+log and the manifest. hashver -tree can then check a disk against
+the root using every CPU; the linear digests are still computed here
+for the record.
+
+Several devices can be hashed at once: the device on the command line
+and each -drive, each read by its own thread (a reader and its digest
+threads per device, see hash_ranges), so the before hashes of the
+source, destination and media disks take as long as the largest disk
+rather than the sum of all three. With -range and -partitions the
+sector ranges sechash would hash are hashed in the same pass over each
+device and logged in sechash's form, to hashbsec.txt with -before and
+hashasec.txt with -after (or the -log_name file). Each device gets its
+own records in the logs, written in command line order once every
+device is done.
+
+program outline
+	get command line
+	open the devices and list their ranges
+	hash the devices, one thread each
+	log results for each device
+*****************************************************************/
+# include <pthread.h>
+
+# define MAX_DRIVES	16
+# define MAX_RANGES	64	/* sector ranges per device, and the whole disk */
+
+typedef struct { /* one device to hash */
+	char		*drive, /* device name */
+			*label, /* label from the command line */
+			manifest[NAME_LENGTH]; /* manifest file (or empty) */
+	disk_control_ptr d;
+	int		open_status,
+			status,	/* hash_ranges status */
+			n_ranges,
+			no_table, /* -partitions but no partition table */
+			whole;	/* index of the whole disk range in r */
+	hash_range	r[MAX_RANGES + 1];
+	off_t		n_read,
+			total;	/* sectors to read */
+	range_ptr	error;
+	progress_ptr	progress;
+	pthread_t	thread;
+	int		thread_started;
+} drive_rec;
+
+static hash_range	ranges[MAX_RANGES]; /* -range list, for every device */
+static int		n_ranges = 0;
+
+/*****************************************************************
+Thread body: hash the ranges of one device in one pass
+*****************************************************************/
+void *hash_drive (void *arg)
+{
+	drive_rec	*r = (drive_rec *) arg;
+
+	r->status = hash_ranges (r->d,r->r,r->n_ranges,HASH_ALL,r->error,
+		&r->n_read,r->progress);
+	return NULL;
+}
+
+/*****************************************************************
+Write the fields every record starts with
+*****************************************************************/
+void log_head (FILE *log, int np, char **p, drive_rec *r, char *comment,
+	char *hash)
+{
+	struct utsname	u;
+	int		i;
+
+	fprintf (log,"%s compiled on %s at %s\n",SCCS_ID[0],SCCS_ID[1],SCCS_ID[2]);
+	fprintf (log,"CMD:");
+	for (i = 0; i < np; i++) fprintf (log," %s",p[i]);
+	fprintf (log,"\n");
+	fprintf (log,"Case: %s\n",p[1]);
+	fprintf (log,"Host: %s\n",p[2]);
+	fprintf (log,"User: %s\n",p[3]);
+	fprintf (log,"Device: %s\n",r->drive);
+	fprintf (log,"Label: %s\n",r->label);
+	fprintf (log,"Comment: %s\n",comment);
+	fprintf (log,"Hash: %s\n",hash);
+	if (uname (&u) == 0)
+		fprintf (log,"%s %s %s %s %s\n",u.sysname,u.nodename,u.release,
+			u.version,u.machine);
+	fprintf (log,"%s\n",ZH_H_ID);
+	fprintf (log,"Hash kernels: %s\n",hash_kernels());
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s TestCase Host User Device Label [-options]\n",p);
+	printf ("-before\tName the logfiles hashblog.txt and hashbsec.txt (ranges)\n");
+	printf ("-after\tName the logfiles hashalog.txt and hashasec.txt (ranges)\n");
+	printf ("-drive <device> <label>\tAlso hash <device> at the same time (may be repeated)\n");
+	printf ("-range <first> <last>\tAlso hash sectors first through last of each device (may be repeated)\n");
+	printf ("-partitions\tAlso hash each partition of each device\n");
+	printf ("-comment \" ... \"\tGive a comment on command line\n");
+	printf ("-hash <name>\tDigest to log in the old format: md5sum, sha1sum (default) or sha256sum\n");
+	printf ("-manifest <name>\tWrite a segment manifest to <name> (<label><name> for each of several devices)\n");
+	printf ("-segment_mb nnn\tManifest segments of nnn MB (%d to %d, default %d)\n",
+		SEG_MIN_MB,SEG_MAX_MB,SEG_MB);
+	printf ("-tree\tAlso compute a tree hash with a pool of threads\n");
+	printf ("-tree_kb nnn\tTree leaves of nnn KB (a power of two, %d to %d, default %d)\n",
+		TREE_MIN_KB,TREE_MAX_KB/2,TREE_LEAF/2);
+	printf ("-threads nnn\tTree hash threads per device (default one per CPU)\n");
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tName the log file <name> (ranges are logged there too)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		hex[2*HASH_MAX_SIZE + 1];
+	int		help = 0,
+			status,
+			i,
+			k,
+			n_logs = 0,
+			n_drives = 0,
+			partitions = 0,
+			seg_mb = SEG_MB,
+			tree = 0,
+			tree_kb = TREE_LEAF/2,
+			n_threads = sysconf (_SC_NPROCESSORS_ONLN),
+			legacy = HASH_SHA1,
+			bad = 0;
+	static drive_rec drives[MAX_DRIVES];
+	drive_rec	*r;
+	hash_range_ptr	w;
+	off_t		from_lba,
+			to_lba,
+			total = 0;
+	progress_ptr	progress;
+	static time_t	from;
+	FILE		*log,
+			*sec_log,
+			*mf;
+	char		comment[NAME_LENGTH] = "",
+			manifest[NAME_LENGTH] = "",
+			all[NAME_LENGTH],
+			log_name[NAME_LENGTH] = "none.txt",
+			sec_log_name[NAME_LENGTH] = "none.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 6) {
+		printf ("At least one required parameter is missing\n");
+		help = 1;
+	} else {
+		drives[0].drive = p[4];
+		drives[0].label = p[5];
+		n_drives = 1;
+	}
+	for (i = 6; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-partitions")== 0) partitions = 1;
+		else if (strcmp (p[i],"-before")== 0) {
+			n_logs++;
+			strcpy (log_name,"hashblog.txt");
+			strcpy (sec_log_name,"hashbsec.txt");
+		}
+		else if (strcmp (p[i],"-after")== 0) {
+			n_logs++;
+			strcpy (log_name,"hashalog.txt");
+			strcpy (sec_log_name,"hashasec.txt");
+		}
+		else if (strcmp (p[i],"-drive")== 0) {
+			i += 2;
+			if (i >= np) {
+				printf ("%s: -drive option requires a drive and a label\n",p[0]);
+				help = 1;
+			} else if (n_drives >= MAX_DRIVES) {
+				printf ("%s: at most %d drives\n",p[0],MAX_DRIVES);
+				help = 1;
+			} else {
+				drives[n_drives].drive = p[i-1];
+				drives[n_drives].label = p[i];
+				n_drives++;
+			}
+		}
+		else if (strcmp (p[i],"-range")== 0){
+			i += 2;
+			if (i >= np || sscanf (p[i-1],"%lld",&from_lba) != 1
+					|| sscanf (p[i],"%lld",&to_lba) != 1){
+				printf ("%s: -range option requires first and last sectors\n",p[0]);
+				help = 1;
+			} else if (from_lba < 0 || to_lba < from_lba) {
+				printf ("%s: invalid range %s %s\n",p[0],p[i-1],p[i]);
+				help = 1;
+			} else if (n_ranges >= MAX_RANGES) {
+				printf ("More than %d ranges\n",MAX_RANGES);
+				help = 1;
+			} else {
+				ranges[n_ranges].first = from_lba;
+				ranges[n_ranges].last = to_lba;
+				strcpy (ranges[n_ranges].label,"range");
+				n_ranges++;
+			}
+		}
+		else if (strcmp (p[i],"-comment")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -comment option requires a comment\n",p[0]);
+				help = 1;
+			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			n_logs++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else {
+				strncpy(log_name, p[i], NAME_LENGTH - 1);
+				strncpy(sec_log_name, p[i], NAME_LENGTH - 1);
+			}
+		}
+		else if (strcmp (p[i],"-manifest")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -manifest option requires a file name\n",p[0]);
+				help = 1;
+			} else strncpy(manifest, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-segment_mb")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -segment_mb option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&seg_mb) != 1
+					|| seg_mb < SEG_MIN_MB || seg_mb > SEG_MAX_MB){
+				printf ("%s: -segment_mb must be %d to %d\n",p[0],
+					SEG_MIN_MB,SEG_MAX_MB);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-tree")== 0) tree = 1;
+		else if (strcmp (p[i],"-tree_kb")== 0){
+			i++;
+			tree = 1;
+			if (i >= np){
+				printf ("%s: -tree_kb option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&tree_kb) != 1 || tree_kb < TREE_MIN_KB
+					|| tree_kb > TREE_MAX_KB/2 || (tree_kb & (tree_kb - 1))){
+				printf ("%s: -tree_kb must be a power of two from %d to %d\n",p[0],
+					TREE_MIN_KB,TREE_MAX_KB/2);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-threads")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -threads option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&n_threads) != 1
+					|| n_threads < 1 || n_threads > TREE_MAX_THREADS){
+				printf ("%s: -threads must be 1 to %d\n",p[0],TREE_MAX_THREADS);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-hash")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -hash option requires the name of a hash\n",p[0]);
+				help = 1;
+			} else if ((legacy = hash_lookup (p[i])) < 0){
+				printf ("%s: unknown hash %s\n",p[0],p[i]);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (!help && n_logs == 0) {
+		printf ("Must select -before, -after, or -log_name <name>\n");
+		help = 1;
+	}
+	if (n_logs > 1) {
+		printf ("Too many log files specified\n");
+		help = 1;
+	}
+	if (help) {
+		print_help(p[0]);
+		return 1;
+	}
+	if (strlen(comment) == 0) {
+		printf ("Please enter a descriptive comment\n");
+		fgets(comment, NAME_LENGTH, stdin);
+		comment[strcspn (comment,"\n")] = '\0';
+	}
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = fopen (log_name,access);
+	if (log == NULL){
+		log = stdout;
+		printf("open of log file unsuccessful...using stdout instead\n");
+	}
+	sec_log = log;
+	if ((n_ranges || partitions) && strcmp (sec_log_name,log_name)) {
+		sec_log = fopen (sec_log_name,access);
+		if (sec_log == NULL){
+			sec_log = stdout;
+			printf("open of log file %s unsuccessful...using stdout instead\n",
+				sec_log_name);
+		}
+	}
+	sprintf (all,"%s %s %s (%s in the old format)",hash_name(HASH_MD5),
+		hash_name(HASH_SHA1),hash_name(HASH_SHA256),hash_name(legacy));
+
+	/* open each device and list its ranges, the whole disk last */
+	for (k = 0; k < n_drives; k++) {
+		r = drives + k;
+		r->d = open_image (r->drive,&status);
+		if (status){
+			printf ("%s could not access drive %s status code %d\n",
+				p[0],r->drive,status);
+			log_head (log,np,p,r,comment,all);
+			fprintf (log,"%s could not access drive %s status code %d\n",
+				p[0],r->drive,status);
+			return 1;
+		}
+		memcpy (r->r,ranges,n_ranges*sizeof(hash_range));
+		r->n_ranges = n_ranges;
+		if (partitions && hash_partition_ranges (r->d,r->r,&r->n_ranges,MAX_RANGES)) {
+			/* a blank disk has none; hash the rest of it anyway */
+			printf ("%s: could not read the partition table of %s (or more than %d ranges)\n",
+				p[0],r->drive,MAX_RANGES);
+			r->n_ranges = n_ranges;
+			r->no_table = 1;
+		}
+		for (i = 0; i < r->n_ranges; i++)
+			if (r->r[i].last >= n_sectors(r->d)) {
+				printf ("Last sector (%lld) is after end of drive %s (%lld)\n",
+					r->r[i].last,r->drive,n_sectors(r->d));
+				return 1;
+			}
+		w = r->r + r->n_ranges++;
+		memset (w,0,sizeof(*w));
+		w->first = 0;
+		w->last = n_sectors(r->d) - 1;
+		strcpy (w->label,"whole disk");
+		if (manifest[0]) {
+			if (n_drives == 1) strcpy (r->manifest,manifest);
+			else snprintf (r->manifest,NAME_LENGTH,"%s%s",r->label,manifest);
+			w->manifest = manifest_create (r->drive,legacy,0,n_sectors(r->d),
+				(off_t) seg_mb*(1024*1024/BYTES_PER_SECTOR));
+			if (w->manifest == NULL) r->status = 1;
+		}
+		if (tree) {
+			w->tree = tree_create (legacy,0,n_sectors(r->d),
+				(off_t) tree_kb*(1024/BYTES_PER_SECTOR),n_threads);
+			if (w->tree == NULL) r->status = 1;
+		}
+		r->error = create_range_list();
+		r->total = hash_sort_ranges (r->r,r->n_ranges);
+		for (i = 0; i < r->n_ranges; i++)
+			if (strcmp (r->r[i].label,"whole disk") == 0) r->whole = i;
+		total += r->total;
+	}
+
+	printf ("run start %s",ctime(&from));
+	progress = progress_start ("",0,total);
+	for (k = 0; k < n_drives; k++) {
+		r = drives + k;
+		if (r->status) continue;
+		r->progress = progress;
+		if (pthread_create (&r->thread,NULL,hash_drive,r) == 0)
+			r->thread_started = 1;
+		else hash_drive (r);
+	}
+	for (k = 0; k < n_drives; k++)
+		if (drives[k].thread_started) pthread_join (drives[k].thread,NULL);
+	progress_end (progress);
+
+	for (k = 0; k < n_drives; k++) {
+		r = drives + k;
+		w = r->r + r->whole;
+		log_head (log,np,p,r,comment,all);
+		log_disk (log,"Hash",r->d);
+		if (r->status) {
+			printf ("%s: not enough memory or threads to hash %s\n",p[0],r->drive);
+			fprintf (log,"%s: not enough memory or threads to hash %s\n",p[0],r->drive);
+			log_close (log,from);
+			fprintf (log," \n \n");
+			bad = 1;
+			continue;
+		}
+		fprintf (log,"%llu sectors hashed\n",w->last + 1);
+		if (w->n_error) {
+			fprintf (log,"%llu sectors could not be read (hashed as zero)\n",w->n_error);
+			print_range_list (log,"Read error range: ",r->error);
+			bad = 1;
+		}
+		for (i = 0; i < HASH_N; i++)
+			fprintf (log,"%s %s\n",hash_name(i),
+				hash_hex (w->digest[i],hash_size(i),hex));
+		fprintf (log,"%s  -\n",hash_hex (w->digest[legacy],hash_size(legacy),hex));
+		printf ("%s  - %s %s\n",hex,r->drive,r->label);
+		if (w->tree) {
+			fprintf (log,"Tree %s root %s (%ld leaves of %d KB, %d threads)\n",
+				hash_name(legacy),hash_hex (w->tree->root,hash_size(legacy),hex),
+				w->tree->n_leaves,tree_kb,w->tree->n_threads);
+			printf ("Tree %s root %s\n",hash_name(legacy),hex);
+			if (w->manifest) {
+				w->manifest->tree_leaf = w->tree->leaf;
+				memcpy (w->manifest->tree_root,w->tree->root,HASH_MAX_SIZE);
+			}
+		}
+		if (w->manifest) {
+			mf = fopen (r->manifest,"w");
+			if (mf == NULL) {
+				printf ("%s: could not create manifest %s\n",p[0],r->manifest);
+				fprintf (log,"Could not create manifest %s\n",r->manifest);
+			} else {
+				manifest_write (mf,w->manifest);
+				fclose (mf);
+				fprintf (log,"Manifest %s: %d segments of %d MB\n",r->manifest,
+					w->manifest->n_segs,seg_mb);
+			}
+		}
+		log_close (log,from);
+		fprintf (log," \n \n");
+		if (r->n_ranges == 1 && !r->no_table) continue;
+
+		/* the sector ranges, in sechash's form */
+		log_head (sec_log,np,p,r,comment,hash_name(legacy));
+		log_disk (sec_log,"Hash",r->d);
+		fprintf (sec_log,"%d ranges, read with the whole disk\n",r->n_ranges - 1);
+		if (r->no_table)
+			fprintf (sec_log,"Partition table could not be read (or more than %d ranges)\n",
+				MAX_RANGES);
+		for (i = 0; i < r->n_ranges; i++) {
+			if (i == r->whole) continue;
+			fprintf (sec_log,"Hash %llu sectors from %llu through %llu (%s)\n",
+				r->r[i].last - r->r[i].first + 1,r->r[i].first,r->r[i].last,
+				r->r[i].label);
+			if (r->r[i].n_error)
+				fprintf (sec_log,"%llu sectors could not be read (hashed as zero)\n",
+					r->r[i].n_error);
+			fprintf (sec_log,"%s  -\n",hash_hex (r->r[i].digest[legacy],
+				hash_size(legacy),hex));
+			printf ("%s  - %llu-%llu %s %s\n",hex,r->r[i].first,r->r[i].last,
+				r->label,r->r[i].label);
+		}
+		if (w->n_error) print_range_list (sec_log,"Read error range: ",r->error);
+		log_close (sec_log,from);
+		fprintf (sec_log," \n \n");
+	}
+	return bad;
+}
@@ -28,12 +28,17 @@ redistribution.
 /***** Author: Dr. James R. Lyle, NIST/SDCT/SQG ****/
 /***** Revised by Ben Livelsberger, NIST/SDCT   ****/
 /* Modified by Kelsey Rider, NIST/SDCT June 2004 */
+# define _GNU_SOURCE /* for O_DIRECT */
 # include <stdio.h>
 # include <string.h>
 # include "zbios.h"
 # include <time.h>
 # include <malloc.h>
 # include <unistd.h>
+# include <stdlib.h>
+# include <pthread.h>
+# include <fcntl.h>
+# include <errno.h>
 
 /*****************************************************************
 Write a known pattern to each sector of a disk:
@@ -46,62 +51,480 @@ Write a known pattern to each sector of a disk:
 
 
 /*****************************************************************
-Wipe n_sect sectors of the disk with fill
-	d describes the disk to wipe
-	n_sect is the number of sectors to wipe
+The disk is written WIPE_TRACKS tracks at a time with up to
+WIPE_WRITERS writes in progress at once. The main thread makes the
+pattern for one batch after another and puts each batch in a ring
+of WIPE_BUFFERS buffers; the writer threads take the batches from
+the ring in order and write them. A buffer is reused as soon as its
+write completes. A final mysync commits everything to the disk.
+
+With a check (-verify) another thread reads the disk back with
+O_DIRECT, staying lag sectors behind the last sector known to be
+written, and compares it with the pattern. The check ends shortly
+after the wipe does; its results are left in the wipe_check.
+*****************************************************************/
+# define WIPE_TRACKS	128	/* tracks per write (about 4 MB) */
+# define WIPE_WRITERS	4	/* writes in progress at once */
+# define WIPE_BUFFERS	(WIPE_WRITERS + 2) /* batches made ahead of the writers */
+
+# define WB_FREE	0	/* wipe_batch states */
+# define WB_FULL	1	/* made, waiting for a writer */
+# define WB_BUSY	2	/* being written */
+# define WB_DONE	3	/* written, waiting for the batches before it */
+# define VERIFY_LAG	64	/* default MB the read back stays behind */
+
+typedef struct {
+	unsigned char	*buf;	/* WIPE_TRACKS tracks of pattern */
+	off_t		lba,	/* where it goes */
+			n,	/* number of sectors to write */
+			off,	/* first sector of buf to write */
+			size,	/* sectors of the disk the batch covers ... */
+			end;	/* ... up to here */
+	int		state;
+} wipe_batch;
+
+typedef struct {
+	off_t		lag,	/* sectors to stay behind the writes */
+			n_read, /* sectors read back */
+			n_bad, /* sectors that differ from the pattern */
+			n_error; /* sectors that could not be read */
+	range_ptr	bad;	/* where they are */
+} wipe_check;
+
+typedef struct {
+	disk_control_ptr d;
+	pthread_mutex_t	lock;
+	pthread_cond_t	change;	/* a batch changed state */
+	wipe_batch	b[WIPE_BUFFERS];
+	int		next_fill, /* next batch for the main thread to make */
+			next_write, /* next batch for a writer */
+			next_done, /* oldest batch not yet written */
+			finished, /* no more batches will be made */
+			status;	/* first write error */
+	off_t		done_to, /* every sector below this has been written */
+			up_to;	/* sectors being wiped (j->ns, not always the disk) */
+	wipe_check	*v;	/* read back check (or NULL) */
+	progress_ptr	progress; /* sectors written, for user feedback */
+	wipe_pattern	w;	/* pattern at the start of the wipe, for the check */
+	int		plain;
+} wipe_ring;
+
+/*****************************************************************
+Writer thread: write batches until the ring is finished and empty
+*****************************************************************/
+void *wipe_writer (void *arg)
+{
+	wipe_ring	*r = (wipe_ring *) arg;
+	wipe_batch	*b;
+	int		status;
+
+	pthread_mutex_lock (&r->lock);
+	while (1) {
+		b = &r->b[r->next_write];
+		if (b->state == WB_FULL) {
+			b->state = WB_BUSY;
+			r->next_write = (r->next_write + 1)%WIPE_BUFFERS;
+			pthread_mutex_unlock (&r->lock);
+			status = write_sectors (r->d, b->lba, b->n,
+				b->buf + b->off*BYTES_PER_SECTOR);
+			pthread_mutex_lock (&r->lock);
+			if (status && !r->status) r->status = status;
+			progress_add (r->progress, b->size);
+			b->state = WB_DONE;
+			/* free the written batches, oldest first */
+			while ((b = &r->b[r->next_done])->state == WB_DONE) {
+				r->done_to = b->end;
+				b->state = WB_FREE;
+				r->next_done = (r->next_done + 1)%WIPE_BUFFERS;
+			}
+			pthread_cond_broadcast (&r->change);
+		} else if (r->finished) break;
+		else pthread_cond_wait (&r->change, &r->lock);
+	}
+	pthread_mutex_unlock (&r->lock);
+	return NULL;
+}
+
+/*****************************************************************
+Checker thread: read the disk back behind the writers, batch by
+batch, and compare it with the pattern. Reads use a separate O_DIRECT
+descriptor so the disk is read, not the page cache.
+*****************************************************************/
+void *wipe_checker (void *arg)
+{
+	wipe_ring		*r = (wipe_ring *) arg;
+	wipe_check		*v = r->v;
+	disk_control_ptr	vd;
+	unsigned char		*buf,
+				*expect;
+	off_t			s,
+				k,
+				j,
+				up_to = r->up_to,
+				spt = DISK_MAX_SECTORS,
+				need;
+	int			stop = 0;
+
+	vd = (disk_control_ptr) malloc (sizeof(disk_control_block));
+	if (!vd || posix_memalign ((void **) &buf, 4096, WIPE_TRACKS*spt*BYTES_PER_SECTOR)
+		|| posix_memalign ((void **) &expect, 4096, WIPE_TRACKS*spt*BYTES_PER_SECTOR)) {
+		printf ("Unable to allocate memory!\n");
+		v->n_error = up_to;
+		return NULL;
+	}
+	*vd = *r->d;
+	if ((vd->fd = open (r->d->dev, O_RDONLY|O_DIRECT)) < 0) {
+		printf ("Unable to open %s for read back: %s\n",r->d->dev,strerror(errno));
+		v->n_error = up_to;
+		return NULL;
+	}
+	if (r->plain) memset (expect, r->w.fill, WIPE_TRACKS*spt*BYTES_PER_SECTOR);
+
+	for (s = 0; s < up_to; s += k) {
+		k = WIPE_TRACKS*spt - s%spt; /* same batches as the writers */
+		if (s + k > up_to) k = up_to - s;
+		need = s + k + v->lag;
+		if (need > up_to) need = up_to;
+		pthread_mutex_lock (&r->lock);
+		while (r->done_to < need && !r->status) pthread_cond_wait (&r->change, &r->lock);
+		stop = r->status && r->done_to < s + k;
+		pthread_mutex_unlock (&r->lock);
+		if (stop) break; /* the wipe failed before getting here */
+
+		if (!r->plain) wipe_pattern_fill (&r->w, expect, k);
+		if (read_sectors (vd, s, k, buf)) {
+			v->n_error += k;
+			for (j = 0; j < k; j++) add_to_range (v->bad, s + j);
+			continue;
+		}
+		v->n_read += k;
+		if (memcmp (buf, expect, k*BYTES_PER_SECTOR) == 0) continue;
+		for (j = 0; j < k; j++)
+			if (memcmp (buf + j*BYTES_PER_SECTOR, expect + j*BYTES_PER_SECTOR,
+					BYTES_PER_SECTOR)) {
+				v->n_bad++;
+				add_to_range (v->bad, s + j);
+			}
+	}
+
+	close (vd->fd);
+	free (vd);
+	free (buf);
+	free (expect);
+	return NULL;
+}
+
+/*****************************************************************
+One disk to wipe. Several disks can be wiped at once (-drive),
+each by its own thread, with its own log and its own progress lines
+(tagged with the drive name).
+*****************************************************************/
+# define MAX_WIPES	8	/* disks wiped at once */
+
+typedef struct {
+	char		drive[NAME_LENGTH],
+			log_name[NAME_LENGTH],
+			tag[NAME_LENGTH]; /* "drive: " in front of messages of several wipes */
+	int		ifill, /* fill as given (hex) */
+			status,
+			thread_started;
+	FILE		*log;
+	disk_control_ptr d;
+	off_t		ns, /* sectors to wipe */
+			n_differ, /* sectors found not in pattern by -incremental */
+			n_rewritten; /* sectors written by -incremental */
+	int		incremental; /* only write sectors not in pattern */
+	wipe_check	check;
+	pthread_t	thread;
+} wipe_job;
+
+static int	n_jobs = 0; /* disks being wiped */
+
+/*****************************************************************
+Wipe the sectors of a disk with fill
+	j describes the disk to wipe (j->d) and the number of
+		sectors to wipe (j->ns)
 	fill is the fill byte
 	start_time is used to estimate time remaining
 	heads is used to specify an alternate disk geometry for
 		the C/H/S address written to the disk (see note in main)
+	plain is set to write just the fill byte (no sector header)
+	v if not NULL asks for the wipe to be read back as it goes
+If j->incremental is set each batch (about 4 MB) is first read from
+the disk (the kernel is asked to read the next one ahead) and only the
+span from the first to the last sector that is not in pattern is
+written, so sectors in pattern inside that span are rewritten too.
+j->n_differ counts the sectors not in pattern, j->n_rewritten the
+sectors written.
 *****************************************************************/
-int do_wipe(disk_control_ptr d, off_t n_sect,unsigned char fill,
-	time_t start_time, int heads)
+int do_wipe(wipe_job *j, unsigned char fill,
+	time_t start_time, int heads, int plain, wipe_check *v)
 {
-	static off_t	track,
-			cylinder,
-			head,
-			sector,
-			s,
+	disk_control_ptr d = j->d;
+	off_t		n_sect = j->ns;
+	off_t		s,
+			k, /* sectors in the batch */
 			hpc, /* heads per cylinder */
 			spt = DISK_MAX_SECTORS; /* sectors per track */
-	unsigned char	*b = (unsigned char *) &d->buffer[0][0];
-	chs_addr	at;
-	int		i;
+	wipe_pattern	w; /* generates the sector contents */
+	wipe_ring	r; /* batches on their way to the disk */
+	wipe_batch	*b;
+	unsigned char	*cur = NULL; /* what is on the disk now (-incremental) */
+	off_t		first,
+			last,
+			m;
+	pthread_t	writer[WIPE_WRITERS],
+			checker;
+	int		i,
+			n_writers = 0,
+			checking = 0,
+			status;
 	off_t		from = 0,
 			up_to = n_sect;
 
 	hpc = (off_t) n_heads(d);
 	if(!hpc) return 1; /* to prevent divide-by-zero error */
 
-	memset (b,fill,63*512);
-	printf ("Wipeout from %llu up to %llu\n",from,up_to);
+	printf ("%sWipeout from %llu up to %llu\n",j->tag,from,up_to);
 	if (heads)printf ("Override heads: %d\n",heads);
 
-	for (s = from; s < up_to; s++){
-		track = s/spt;
-		sector = s%spt + 1;
-		cylinder = track/hpc;
-		head = track%hpc;
-		at.cylinder = cylinder;
-		at.head = head;
-		at.sector = sector;
-		if (heads){
-			cylinder = track/heads;
-			head = track%heads;
+	memset (&r, 0, sizeof(r));
+	r.d = d;
+	r.up_to = up_to;
+	r.progress = progress_start (j->tag, from, up_to);
+	pthread_mutex_init (&r.lock, NULL);
+	pthread_cond_init (&r.change, NULL);
+	for (i = 0; i < WIPE_BUFFERS; i++)
+		if (posix_memalign ((void **) &r.b[i].buf, 4096,
+				WIPE_TRACKS*spt*BYTES_PER_SECTOR)) {
+			printf ("Unable to allocate memory!\n");
+			return 1;
+		} else if (plain) memset (r.b[i].buf, fill,
+				WIPE_TRACKS*spt*BYTES_PER_SECTOR);
+	if (j->incremental && posix_memalign ((void **) &cur, 4096,
+			WIPE_TRACKS*spt*BYTES_PER_SECTOR)) {
+		printf ("Unable to allocate memory!\n");
+		return 1;
+	}
+	j->n_differ = j->n_rewritten = 0;
+	for (i = 0; i < WIPE_WRITERS; i++)
+		if (pthread_create (&writer[n_writers], NULL, wipe_writer, &r) == 0)
+			n_writers++;
+	if (n_writers == 0) {
+		printf ("Unable to start writer threads\n");
+		return 1;
+	}
+
+	wipe_pattern_init (&w, from, heads ? (off_t) heads : hpc, fill);
+	if (v) {
+		r.v = v;
+		r.w = w;
+		r.plain = plain;
+		if (pthread_create (&checker, NULL, wipe_checker, &r) == 0) checking = 1;
+		else {
+			printf ("Unable to start read back thread\n");
+			v->n_error = up_to;
 		}
-		sprintf ((char *)(&(d->buffer[sector-1][0])),
-			"%05llu/%03llu/%02llu %012llu",cylinder,head,sector,s);
-		if ((sector == DISK_MAX_SECTORS) || ((s+1) == up_to)) {
-			if (((s+1) == up_to) && (sector != DISK_MAX_SECTORS))
-				printf ("Note: Partial last track (%llu) written at sector %llu\n", sector,s);
-			at.sector = 1;
-			disk_write (d,&at);
+	}
+	for (s = from; s < up_to; s += k){
+		k = WIPE_TRACKS*spt - s%spt; /* batch ends on a track boundary ... */
+		if (s + k > up_to) k = up_to - s; /* ... or at the end of the disk */
+		if ((s+k) == up_to && ((s+k)%spt))
+			printf ("%sNote: Partial last track (%llu) written at sector %llu\n",
+				j->tag,(s+k-1)%spt + 1,s+k-1);
+
+		/* wait for the next buffer in the ring to be free */
+		pthread_mutex_lock (&r.lock);
+		b = &r.b[r.next_fill];
+		while (b->state != WB_FREE) pthread_cond_wait (&r.change, &r.lock);
+		status = r.status;
+		pthread_mutex_unlock (&r.lock);
+		if (status) break; /* a write failed: stop */
+
+		if (!plain) wipe_pattern_fill (&w, b->buf, k);
+		b->lba = s;
+		b->n = k;
+		b->off = 0;
+		b->size = k;
+		b->end = s + k;
+		if (j->incremental) {
+			if (s + k < up_to)
+				posix_fadvise (d->fd, (s + k)*BYTES_PER_SECTOR,
+					WIPE_TRACKS*spt*BYTES_PER_SECTOR, POSIX_FADV_WILLNEED);
+			/* an unreadable batch is written in full */
+			if (read_sectors (d, s, k, cur) == 0) {
+				if (memcmp (cur, b->buf, k*BYTES_PER_SECTOR) == 0) b->n = 0;
+				else {
+					for (first = 0; memcmp (cur + first*BYTES_PER_SECTOR,
+						b->buf + first*BYTES_PER_SECTOR,
+						BYTES_PER_SECTOR) == 0; first++);
+					for (last = k - 1; memcmp (cur + last*BYTES_PER_SECTOR,
+						b->buf + last*BYTES_PER_SECTOR,
+						BYTES_PER_SECTOR) == 0; last--);
+					for (m = first; m <= last; m++)
+						if (memcmp (cur + m*BYTES_PER_SECTOR,
+							b->buf + m*BYTES_PER_SECTOR,
+							BYTES_PER_SECTOR)) j->n_differ++;
+					b->lba = s + first;
+					b->off = first;
+					b->n = last - first + 1;
+				}
+			} else j->n_differ += b->n;
+			j->n_rewritten += b->n;
 		}
-		feedback (start_time, from, s, up_to);
+
+		pthread_mutex_lock (&r.lock);
+		b->state = WB_FULL;
+		r.next_fill = (r.next_fill + 1)%WIPE_BUFFERS;
+		pthread_cond_broadcast (&r.change);
+		pthread_mutex_unlock (&r.lock);
 	}
 
+	/* let the writers finish */
+	pthread_mutex_lock (&r.lock);
+	r.finished = 1;
+	pthread_cond_broadcast (&r.change);
+	pthread_mutex_unlock (&r.lock);
+	for (i = 0; i < n_writers; i++) pthread_join (writer[i], NULL);
+	progress_end (r.progress);
+	for (i = 0; i < WIPE_BUFFERS; i++) free (r.b[i].buf);
+	if (cur) free (cur);
+
 	/* Sync file (make sure all writing is committed) */
-	return mysync(d->fd);
+	status = mysync(d->fd);
+	if (checking) pthread_join (checker, NULL);
+	return r.status ? r.status : status;
+}
+
+/*****************************************************************
+Zero the sectors of the disk (j) without sending the zeroes from
+here: the kernel writes them, with the device's write zeroes if it
+has one (see zero_sectors). This is done ZERO_CHUNK sectors at a time
+so progress can be shown.
+	returns 0 if zeroed, ZERO_UNSUPPORTED if there is no zero out
+	(not a block device; nothing has been changed then), or an
+	error code
+*****************************************************************/
+# define ZERO_CHUNK	(2*1024*1024) /* sectors per zero out (1 GiB) */
+
+int do_zero(wipe_job *j, time_t start_time)
+{
+	off_t	s,
+		k,
+		n_sect = j->ns;
+	int	status = 0;
+	progress_ptr progress = NULL;
+
+	printf ("%sZero out from %llu up to %llu\n",j->tag,(off_t) 0,n_sect);
+	for (s = 0; s < n_sect; s += k) {
+		k = ZERO_CHUNK;
+		if (s + k > n_sect) k = n_sect - s;
+		status = zero_sectors (j->d, s, k);
+		if (status == ZERO_UNSUPPORTED && s) status = 1; /* part done */
+		if (status) break;
+		/* no progress lines until the device is known to zero out */
+		if (!progress) progress = progress_start (j->tag, 0, n_sect);
+		progress_add (progress, k);
+	}
+	if (progress) progress_end (progress);
+	return status ? status : mysync(j->d->fd);
+}
+
+/*****************************************************************
+Read back a zeroed disk and check that it is all zero. Either every
+sector is read (full) or ZERO_SAMPLES tracks spread over the disk,
+at a random place within each stride, always including the first
+and last track. Sectors that are not zero are listed in the log.
+	returns 0 if everything read is zero, 1 otherwise
+*****************************************************************/
+# define ZERO_SAMPLES	1024 /* tracks read by a sampled check */
+# define VERIFY_BLOCK	8192 /* sectors per read in a full check */
+
+int verify_zero(disk_control_ptr d, off_t n_sect, int full, FILE *log)
+{
+	unsigned char		*zero; /* VERIFY_BLOCK sectors of zero */
+	unsigned char		*buf;
+	range_ptr		bad = create_range_list();
+	off_t			s,
+				k,
+				j,
+				n_bad = 0,
+				n_read = 0,
+				stride,
+				spt = DISK_MAX_SECTORS;
+	int			i,
+				n_samples,
+				status = 0;
+
+	zero = calloc (VERIFY_BLOCK, BYTES_PER_SECTOR);
+	if (!zero || posix_memalign ((void **) &buf, 4096,
+			VERIFY_BLOCK*BYTES_PER_SECTOR)) {
+		printf ("Unable to allocate memory!\n");
+		return 1;
+	}
+	/* read what is on the disk, not what is in the page cache */
+	posix_fadvise (d->fd, 0, 0, POSIX_FADV_DONTNEED);
+
+	if (full) n_samples = (n_sect + VERIFY_BLOCK - 1)/VERIFY_BLOCK;
+	else {
+		n_samples = ZERO_SAMPLES;
+		if (n_sect/spt < n_samples) n_samples = n_sect/spt;
+		if (n_samples < 1) n_samples = 1;
+		srand (time(NULL));
+	}
+	stride = n_samples > 1 ? (n_sect - spt)/(n_samples - 1) : 0;
+	for (i = 0; i < n_samples; i++) {
+		if (full) {
+			s = (off_t) i*VERIFY_BLOCK;
+			k = VERIFY_BLOCK;
+		} else {
+			s = stride*i;
+			if (i && (i < n_samples - 1) && stride > spt)
+				s += (off_t) rand()%(stride - spt);
+			k = spt;
+		}
+		if (s + k > n_sect) k = n_sect - s;
+		if ((status = read_sectors (d, s, k, buf))) break;
+		n_read += k;
+		if (memcmp (buf, zero, k*BYTES_PER_SECTOR) == 0) continue;
+		for (j = 0; j < k; j++) /* find the sectors that are not zero */
+			if (memcmp (buf + j*BYTES_PER_SECTOR, zero, BYTES_PER_SECTOR)) {
+				n_bad++;
+				add_to_range (bad, s + j);
+			}
+	}
+
+	fprintf (log,"Zero verify (%s): %llu sectors read, %llu not zero\n",
+		full ? "full" : "sampled", n_read, n_bad);
+	printf ("Zero verify (%s): %llu sectors read, %llu not zero\n",
+		full ? "full" : "sampled", n_read, n_bad);
+	if (n_bad) print_range_list (log, "Not zero:", bad);
+	if (status) fprintf (log,"Zero verify stopped by read error at lba %llu\n",s);
+	free (buf);
+	free (zero);
+	free (bad);
+	return (n_bad || status) ? 1 : 0;
+}
+
+/*****************************************************************
+Log the verdict of a wipe read back (-verify) to the log of the disk
+	returns 0 if every sector read back as written, 1 otherwise
+*****************************************************************/
+int log_check(wipe_job *j, int lag)
+{
+	wipe_check	*v = &j->check;
+	FILE		*log = j->log;
+	int		ok = (v->n_read == j->ns) && !v->n_bad && !v->n_error;
+
+	fprintf (log,"Verify: %llu sectors read back %d MB behind the writes\n",
+		v->n_read,lag);
+	fprintf (log,"Verify: %llu sectors differ, %llu sectors unreadable\n",
+		v->n_bad,v->n_error);
+	if (v->bad->n) print_range_list (log,"Not as written:",v->bad);
+	fprintf (log,"Verify verdict: %s\n",ok?"wipe verified":"WIPE NOT VERIFIED");
+	printf ("%sVerify: %llu read back, %llu differ, %llu unreadable: %s\n",
+		j->tag,v->n_read,v->n_bad,v->n_error,ok?"wipe verified":"WIPE NOT VERIFIED");
+	return !ok;
 }
 
 /*****************************************************************
@@ -118,7 +541,16 @@ void print_help(char *p)
 	printf ("-src\tWipe a source disk\n");
 	printf ("-media\tWipe a media disk\n");
 	printf ("-dst\tWipe a destination disk (default)\n");
+	printf ("-drive <drive> <fill> <src|dst|media>\tAlso wipe drive, at the same time\n");
+	printf ("\t(may be repeated, each drive is logged to its role's log file)\n");
 	printf ("-heads nnn\tOveride number of heads from BIOS with nnn\n");
+	printf ("-zero\tZero the disk with the device's zero out, no sector header (fill must be 00)\n");
+	printf ("-verify_all\tWith -zero read back every sector (default is a sample)\n");
+	printf ("-verify\tRead back and check each sector while wiping (with -zero, same as -verify_all)\n");
+	printf ("-verify_lag nnn\tWith -verify stay nnn MB behind the writes (default %d)\n",
+		VERIFY_LAG);
+	printf ("-incremental\tOnly write the sectors that are not already in pattern\n");
+	printf ("\t\t(the span from the first to the last of them in each 4 MB batch)\n");
 	printf ("-comment \" ... \"\tGive a comment on command line\n");
 	printf ("-noask\tSupress confirmation dialog\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
@@ -127,28 +559,90 @@ void print_help(char *p)
 }
 
 
+
+/*****************************************************************
+Options that apply to every disk being wiped
+*****************************************************************/
+static int	hd = 0, /* -heads */
+		zero = 0, /* -zero */
+		verify = 0, /* -verify */
+		verify_all = 0, /* -verify_all */
+		incremental = 0, /* -incremental */
+		lag = VERIFY_LAG; /* -verify_lag */
+static time_t	from; /* when the wipe started */
+static char	*prog; /* program name for messages */
+
+/*****************************************************************
+Wipe one disk and log the result to its log (thread body)
+*****************************************************************/
+void *run_job (void *arg)
+{
+	wipe_job	*j = (wipe_job *) arg;
+	unsigned char	fill = j->ifill;
+	int		status;
+	FILE		*log = j->log;
+
+	if (zero) {
+		status = do_zero(j,from);
+		if (status == ZERO_UNSUPPORTED) {
+			printf ("Zero out not supported by %s, writing zeroes\n",j->drive);
+			fprintf (log,"Zero out not supported by %s, writing zeroes\n",j->drive);
+			status = do_wipe(j,fill,from,hd,1,NULL);
+		} else if (!status) fprintf (log,"Zeroed with BLKZEROOUT (device write zeroes, or kernel-written zeroes)\n");
+		/* -verify asks for every sector to be checked */
+		if (!status) status = verify_zero(j->d,j->ns,verify_all || verify,log);
+	} else if (verify) {
+		j->check.lag = (off_t) lag*(1024*1024/BYTES_PER_SECTOR);
+		j->check.bad = create_range_list();
+		status = do_wipe(j,fill,from,hd,0,&j->check);
+		if (!status) status = log_check(j,lag);
+	} else status = do_wipe(j,fill,from,hd,0,NULL);
+	if (j->incremental) {
+		fprintf (log,"%llu sectors not in pattern, %llu rewritten (span of each batch), %llu already in pattern\n",
+			j->n_differ,j->n_rewritten,j->ns - j->n_differ);
+		printf ("%s%llu sectors not in pattern, %llu rewritten (span of each batch), %llu already in pattern\n",
+			j->tag,j->n_differ,j->n_rewritten,j->ns - j->n_differ);
+	}
+	if (status) {
+		printf ("%serror code %d in %s\n",j->tag,status,prog);
+		fprintf (log,"error code %d in %s\n",status,prog);
+	} else {
+		fprintf (log,"%llu sectors wiped with %2X\n",j->ns,j->ifill);
+		printf ("%s%llu sectors wiped with %2X\n",j->tag,j->ns,j->ifill);
+	}
+	log_close (log,from);
+	j->status = status;
+	return NULL;
+}
+
+/*****************************************************************
+Log file for a role (src, dst, media), NULL if not a role
+*****************************************************************/
+char *role_log(char *role)
+{
+	if (strcmp (role,"src") == 0) return "wipeslog.txt";
+	if (strcmp (role,"dst") == 0) return "wipedlog.txt";
+	if (strcmp (role,"media") == 0) return "wipemlog.txt";
+	return NULL;
+}
+
 main (int np, char **p)
 {
-	char		drive[NAME_LENGTH] = "/dev/hda"; /* default to primary IDE master */
 	int		help = 0,
-			ifill,
 			n_logs = 0;
 	int		status,
 			i,
+			k,
 			is_debug = 0,
-			ask = 1,
-			hd = 0;
-	off_t	 	ns;
-	static disk_control_block *dd;
-	unsigned char	fill;
+			ask = 1;
+	static wipe_job	jobs[MAX_WIPES];
+	wipe_job	*j;
 	char		ans[NAME_LENGTH];
-	static time_t	from;
-	FILE		*log;
 	char		comment[NAME_LENGTH] = "",
-			log_name[NAME_LENGTH] = "wipedlog.txt",
 			access[2] = "a";
 
 	time(&from);
+	prog = p[0];
 	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
 	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
 		__TIME__,__VERSION__);
@@ -158,17 +652,53 @@ main (int np, char **p)
 	}
 	printf("\n");
 
-
+	/* the first disk is on the command line, default to primary IDE master */
+	n_jobs = 1;
+	strncpy(jobs[0].drive, "/dev/hda", NAME_LENGTH - 1);
+	strncpy(jobs[0].log_name, "wipedlog.txt", NAME_LENGTH - 1);
 	if (np < 6) help = 1;
-	else strncpy(drive, p[4], NAME_LENGTH - 1);
-	printf ("Drive %s\n",drive);
+	else strncpy(jobs[0].drive, p[4], NAME_LENGTH - 1);
+	printf ("Drive %s\n",jobs[0].drive);
 	for (i = 6; i < np; i++) {
 		if (strcmp (p[i],"-h") == 0) help = 1;
-		else if (strcmp (p[i],"-src")== 0){strncpy(log_name, "wipeslog.txt", NAME_LENGTH - 1); n_logs++;}
-		else if (strcmp (p[i],"-media")== 0){strncpy(log_name, "wipemlog.txt", NAME_LENGTH - 1); n_logs++;}
-		else if (strcmp (p[i],"-dst")== 0){strncpy(log_name, "wipedlog.txt", NAME_LENGTH - 1); n_logs++;}
+		else if (strcmp (p[i],"-src")== 0){strncpy(jobs[0].log_name, "wipeslog.txt", NAME_LENGTH - 1); n_logs++;}
+		else if (strcmp (p[i],"-media")== 0){strncpy(jobs[0].log_name, "wipemlog.txt", NAME_LENGTH - 1); n_logs++;}
+		else if (strcmp (p[i],"-dst")== 0){strncpy(jobs[0].log_name, "wipedlog.txt", NAME_LENGTH - 1); n_logs++;}
 		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
 		else if (strcmp (p[i],"-noask") == 0) ask = 0;
+		else if (strcmp (p[i],"-zero") == 0) zero = 1;
+		else if (strcmp (p[i],"-verify_all") == 0) verify_all = 1;
+		else if (strcmp (p[i],"-verify") == 0) verify = 1;
+		else if (strcmp (p[i],"-incremental") == 0) incremental = 1;
+		else if (strcmp (p[i],"-verify_lag")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -verify_lag option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&lag) != 1 || lag < 0){
+				printf ("%s: invalid -verify_lag value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-drive")== 0){
+			if (i + 3 >= np){
+				printf ("%s: -drive option requires a drive, a fill and a role\n",p[0]);
+				help = 1;
+				break;
+			}
+			if (n_jobs >= MAX_WIPES){
+				printf ("%s: at most %d drives can be wiped at once\n",p[0],MAX_WIPES);
+				return 1;
+			}
+			if (role_log(p[i+3]) == NULL){
+				printf ("%s: drive role must be src, dst or media, not %s\n",p[0],p[i+3]);
+				help = 1;
+			} else strncpy(jobs[n_jobs].log_name, role_log(p[i+3]), NAME_LENGTH - 1);
+			strncpy(jobs[n_jobs].drive, p[i+1], NAME_LENGTH - 1);
+			sscanf (p[i+2],"%2x",&jobs[n_jobs].ifill); /* first two characters are HEX */
+			n_jobs++;
+			i += 3;
+		}
 		else if (strcmp (p[i],"-comment")== 0){
 			i++;
 			if (i >= np){
@@ -181,7 +711,7 @@ main (int np, char **p)
 			if (i >= np){
 				printf ("%s: -log_name option requires a logfile name\n",p[0]);
 				help = 1;
-			} else {strncpy(log_name, p[i], NAME_LENGTH - 1);n_logs++;}
+			} else {strncpy(jobs[0].log_name, p[i], NAME_LENGTH - 1);n_logs++;}
 		}
 		else if (strcmp (p[i],"-heads")== 0){
 			i++;
@@ -210,55 +740,85 @@ the actual addresses.
 		return 0;
 	}
 	if (n_logs > 1) {
-		printf ("Note: multiple log file names specified\nEnter \"y\" if %s is ok:", log_name);
+		printf ("Note: multiple log file names specified\nEnter \"y\" if %s is ok:", jobs[0].log_name);
 		scanf("%s", ans);
 		if(ans[0] != 'y') return 1;
 	}
+	sscanf (p[5],"%2x",&jobs[0].ifill); /* note first two characters of label are HEX */
+	if (zero && incremental) {
+		printf ("%s: -incremental can't be used with -zero\n",p[0]);
+		return 1;
+	}
+	for (i = 0; i < n_jobs; i++) {
+		jobs[i].incremental = incremental;
+		if (zero && jobs[i].ifill) {
+			printf ("%s: -zero requires a fill of 00\n",p[0]);
+			return 1;
+		}
+		for (k = 0; k < i; k++) {
+			if (strcmp (jobs[i].drive,jobs[k].drive) == 0) {
+				printf ("%s: drive %s given more than once\n",p[0],jobs[i].drive);
+				return 1;
+			}
+			if (strcmp (jobs[i].log_name,jobs[k].log_name) == 0) {
+				printf ("%s: drives %s and %s would share log %s\n",p[0],
+					jobs[k].drive,jobs[i].drive,jobs[i].log_name);
+				return 1;
+			}
+		}
+		if (n_jobs > 1) snprintf (jobs[i].tag,NAME_LENGTH,"%s: ",jobs[i].drive);
+	}
 	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
-	log = log_open(log_name,access,comment,SCCS_ID,np,p);
 
-	time(&from);
-	sscanf (p[5],"%2x",&ifill); /* note first two characters of label are HEX */
-	fill = ifill;
-	if (ask){
-		printf ("This program will erase (WIPEOUT) disk %s OK? (y/n)?",
-			drive);
-		scanf ("%s",ans);
-		if (ans[0] != 'y') return 1;
-		printf ("Do you want to WIPEOUT disk %s with %02X? (y/n)?",
-			drive,ifill);
-		scanf ("%s",ans);
-		if (ans[0] != 'y') return 1;
-	}
+	/* open every log and disk before anything is wiped */
+	for (i = 0; i < n_jobs; i++) {
+		j = &jobs[i];
+		j->log = log_open(j->log_name,access,comment,SCCS_ID,np,p);
+		if (ask){
+			printf ("This program will erase (WIPEOUT) disk %s OK? (y/n)?",
+				j->drive);
+			scanf ("%s",ans);
+			if (ans[0] != 'y') return 1;
+			printf ("Do you want to WIPEOUT disk %s with %02X? (y/n)?",
+				j->drive,j->ifill);
+			scanf ("%s",ans);
+			if (ans[0] != 'y') return 1;
+		}
 
-	dd = open_disk (drive,&status);
-	if (status){
-		printf ("%s could not access drive %s status code %d\n",
-			p[0],drive,status);
-		fprintf (log,"%s could not access drive %s status code %d\n",
-			p[0],drive,status);
-		return 1;
-	}
-	log_disk(log,"Wipe",dd);
-	if (hd) {
-		if(hd < 0) {
-			printf("Invalid value (%d) for number of heads\n", hd);
+		j->d = open_disk (j->drive,&status);
+		if (status){
+			printf ("%s could not access drive %s status code %d\n",
+				p[0],j->drive,status);
+			fprintf (j->log,"%s could not access drive %s status code %d\n",
+				p[0],j->drive,status);
 			return 1;
 		}
-		fprintf (log,"Override number of heads from %llu to %d\n",
-			dd->disk_max.head,hd);
+		log_disk(j->log,"Wipe",j->d);
+		if (hd) {
+			if(hd < 0) {
+				printf("Invalid value (%d) for number of heads\n", hd);
+				return 1;
+			}
+			fprintf (j->log,"Override number of heads from %llu to %d\n",
+				j->d->disk_max.head,hd);
+		}
+/*		print_dcb(j->d);       */
+		j->ns = n_sectors(j->d);
+		if (is_debug) j->ns = 100;
 	}
-/*	print_dcb(dd);       */
-	ns = n_sectors(dd);
-	if (is_debug) ns = 100;
-	status = do_wipe(dd,ns,fill,from,hd);
-	if (status) {
-		printf ("error code %d in %s\n",status,p[0]);
-		fprintf (log,"error code %d in %s\n",status,p[0]);
-	} else {
-		fprintf (log,"%llu sectors wiped with %2X\n",ns,ifill);
-		printf ("%llu sectors wiped with %2X\n",ns,ifill);
+
+	time(&from);
+	if (n_jobs == 1) run_job (&jobs[0]);
+	else {
+		/* each disk on its own thread, the slowest one sets the pace */
+		for (i = 0; i < n_jobs; i++)
+			if (pthread_create (&jobs[i].thread, NULL, run_job, &jobs[i]) == 0)
+				jobs[i].thread_started = 1;
+			else run_job (&jobs[i]);
+		for (i = 0; i < n_jobs; i++)
+			if (jobs[i].thread_started) pthread_join (jobs[i].thread, NULL);
 	}
-	log_close (log,from);
+	status = 0;
+	for (i = 0; i < n_jobs; i++) if (jobs[i].status && !status) status = jobs[i].status;
 	return status;
 }
@@ -13,22 +13,14 @@ read "os"
 
 #source disk initialisation
 function sdisk{
-./partab $case $host $op $src
 echo "Warning source drive will be wiped proceed?[y/n]"
 read "con"
 if [ "$con" == "y*" ]
 echo "Fill: enter a two digit hexvalue to fill the sectors"
 read "sfill"
-then ./diskwipe $case $host $op $src $sfill -src -noask   
+then wipes="-drive $src $sfill src"
 else sha1sum $src > srcbhash.txt
 fi
-#diskhash and sechash
-./diskhash.csh $case $host $op $src -after
-./sechash.csh $case $host $op $src -after
-./diskhash.csh $case $host $op $dst -before
-./sechash.csh $case $host $op $dst -before
-#partab
-./partab $case $host $op $src -all
 ddisk
 }
 
@@ -41,19 +33,16 @@ read "dst"
 echo -n "Media Disk:"
 read "media"
 ./logcase $case $host $op $src $dst $media
-#diskhash and sechash
-./diskhash.csh $case $host $op $src -before 
-./sechash.csh $case $host $op $src -before
+#partition tables of all three disks in one pass
+./partab $case $host $op $src src -drive $dst dst -drive $media media -all
+#before hashes of all three disks at once: whole disks (hashblog.txt,
+#srcbman.txt dstbman.txt mediabman.txt) and sector ranges (hashbsec.txt)
+./diskhash $case $host $op $src src -drive $dst dst -drive $media media -before -manifest bman.txt -range 0 62 -partitions
 sdisk
 #Destination disk initialisation
 function ddisk{
 echo "enter a two digit hex value to fill the sectors:"
 read "dfill"
-./partab $case $host $op $dst -all
-./diskwipe $case $host $op $dst $dfill -dst
-#diskhash and sechash
-./diskhash.csh $case $host $op $dst -after
-./sechash.csh $case $host $op $dst -after
 #choice for partition function
 echo "Do you need partition?[y/n]"
 read "part"
@@ -61,6 +50,7 @@ if [ "part" == "y*" ]
 then partition
 else media 
 fi
+wipe
 }
 #Partition function
 function partition{
@@ -70,16 +60,14 @@ if [ "$choice" == "y*" ]
 }
 #Media Disk wipe
 function media{
-#diskhash and sechash
-./diskhash.csh $case $host $op $media -before
-./sechash.csh $case $host $op $media -before
 echo "enter a unique pattern to the media disk"
 read "mfill"
-./partab $case $host $op $media -all
-./diskwipe $case $host $op $media $mfill -media
-#diskhash and sechash
-./diskhash.csh $case $host $op $media -after
-./sechash.csh $case $host $op $media -after
+wipes="$wipes -drive $media $mfill media"
+}
+#Wipe the destination and any other disks chosen above in one run,
+#all at once. The wipe reads itself back, its log carries the verdict
+function wipe{
+./diskwipe $case $host $op $dst $dfill -dst -verify $wipes
 }
 #use the tool to make an image file
 #Corrupt
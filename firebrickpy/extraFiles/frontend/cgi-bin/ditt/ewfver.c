@@ -0,0 +1,482 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) ewfver.c Linux Version 1.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <fcntl.h>
+# include <pthread.h>
+# include <zlib.h>
+# include <libewf.h>
+/*****************************************************************
+Verify an EWF (E01) image in bounded memory
+EWFVER checks an image written by ewfacquire: the checksum of every
+chunk and the MD5 and SHA-1 of the media stored in the image. It is
+for the FIREBrick, where ewfverify runs out of memory, so everything
+goes through a fixed ring of chunk slots whose size is set by
+-memory_mb, however large the image:
+	reader (main thread)	reads the stored chunks in order with
+				libewf (libewf is not thread safe, so
+				only this thread calls it)
+	workers (-threads)	take the next chunk read, inflate it (or
+				check the Adler-32 of a chunk stored as
+				is) on their own with zlib
+	hasher			hashes the media data of each chunk in
+				order, then frees its slot
+A bad chunk is hashed as zeroes if it can not be inflated (as
+ewfverify does), logged with its sectors, and the image fails.
+
+Exit status is EWF_OK if every chunk and a stored digest check, and
+EWF_MISMATCH only if a chunk checksum or a stored digest is shown
+not to match. Anything that stops the check being made (the image
+can not be opened, chunks can not be read, no digest is stored)
+is EWF_UNVERIFIED, so scripts can tell a bad image from no answer.
+
+program outline
+	get command line
+	open the image, get its layout and stored digests
+	read, check and hash the chunks through the slot ring
+	log bad chunks and the verdict
+*****************************************************************/
+# define EWF_THREADS	4	/* default number of workers */
+# define EWF_MAX_THREADS 16
+# define EWF_MEMORY_MB	32	/* default ceiling for the slot ring */
+# define EWF_MAX_LINES	100	/* most bad chunks to log one by one */
+
+# define EWF_OK		0	/* exit status: image verifies */
+# define EWF_MISMATCH	1	/* ... a checksum or digest differs */
+# define EWF_UNVERIFIED	2	/* ... could not be checked */
+
+# define SLOT_FREE	0
+# define SLOT_READ	1	/* stored chunk read, to be checked */
+# define SLOT_CHECKED	2	/* media data ready to hash */
+
+typedef struct { /* one chunk on its way through */
+	unsigned char	*raw,	/* the chunk as stored */
+			*buf,	/* inflated media data */
+			*data,	/* its media data (buf, or raw if not compressed) */
+			sum[4];	/* room for libewf to read a checksum into */
+	ssize_t		raw_n;	/* bytes read, -1 if the read failed */
+	size_t		data_n;
+	int8_t		compressed,
+			read_sum; /* chunk_sum was read apart from the data */
+	uint32_t	chunk_sum; /* stored Adler-32 of a chunk not compressed */
+	long		index;	/* chunk number */
+	int		state,	/* SLOT_xxx */
+			bad;
+} ewf_slot;
+
+typedef struct {
+	ewf_slot	*slot;
+	int		n_slots;
+	long		n_chunks,
+			next;	/* next chunk for a worker */
+	size_t		chunk_size;
+	off_t		media_size;
+	hash_ctx	md5,
+			sha1;
+	range_ptr	bad;	/* sectors of bad chunks */
+	long		n_bad,
+			n_unread; /* ... of those, chunks libewf could not read */
+	FILE		*log;
+	progress_ptr	progress;
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+} ewf_job;
+
+/*****************************************************************
+Log a libewf error (and free it)
+*****************************************************************/
+void ewf_error (FILE *log, char *what, libewf_error_t **error)
+{
+	char	text[512] = "";
+
+	if (*error) {
+		libewf_error_sprint (*error,text,sizeof(text));
+		libewf_error_free (error);
+	}
+	printf ("%s: %s\n",what,text);
+	fprintf (log,"%s: %s\n",what,text);
+}
+
+/*****************************************************************
+Check one chunk and put its media data in s->data
+	returns 1 if it is bad, else 0
+*****************************************************************/
+int check_chunk (ewf_slot *s, size_t chunk_size)
+{
+	uLongf		n = chunk_size;
+	unsigned char	*b;
+	uint32_t	sum;
+	size_t		k;
+
+	s->data = s->buf;
+	s->data_n = chunk_size;
+	if (s->raw_n <= 0) {
+		memset (s->data,0,chunk_size);
+		return 1;
+	}
+	if (s->compressed) { /* zlib checks the Adler-32 at the end of the stream */
+		if (uncompress (s->data,&n,s->raw,s->raw_n) != Z_OK) {
+			memset (s->data,0,chunk_size);
+			return 1;
+		}
+		s->data_n = n;
+		return 0;
+	}
+	/* stored as is: Adler-32 after the data, or read on its own */
+	k = s->raw_n;
+	if (s->read_sum) sum = s->chunk_sum;
+	else if (k < 4) return 1;
+	else {
+		b = s->raw + (k -= 4);
+		sum = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+	}
+	s->data = s->raw;
+	s->data_n = k;
+	return adler32 (1L,s->raw,k) != sum;
+}
+
+/*****************************************************************
+Worker body: check the next chunk read until none are left
+*****************************************************************/
+void *check_thread (void *arg)
+{
+	ewf_job		*j = (ewf_job *) arg;
+	ewf_slot	*s;
+	long		i;
+
+	for (;;) {
+		pthread_mutex_lock (&j->lock);
+		i = j->next++;
+		if (i >= j->n_chunks) {
+			pthread_mutex_unlock (&j->lock);
+			return NULL;
+		}
+		s = j->slot + i % j->n_slots;
+		while (!(s->state == SLOT_READ && s->index == i))
+			pthread_cond_wait (&j->wake,&j->lock);
+		pthread_mutex_unlock (&j->lock);
+		s->bad = check_chunk (s,j->chunk_size);
+		pthread_mutex_lock (&j->lock);
+		s->state = SLOT_CHECKED;
+		pthread_cond_broadcast (&j->wake);
+		pthread_mutex_unlock (&j->lock);
+	}
+}
+
+/*****************************************************************
+Hasher body: hash the media data of each chunk in order
+*****************************************************************/
+void *hash_thread (void *arg)
+{
+	ewf_job		*j = (ewf_job *) arg;
+	ewf_slot	*s;
+	off_t		at = 0,
+			k,
+			sec;
+	long		i;
+
+	for (i = 0; i < j->n_chunks; i++) {
+		s = j->slot + i % j->n_slots;
+		pthread_mutex_lock (&j->lock);
+		while (!(s->state == SLOT_CHECKED && s->index == i))
+			pthread_cond_wait (&j->wake,&j->lock);
+		pthread_mutex_unlock (&j->lock);
+		k = s->data_n;
+		if (k > j->media_size - at) k = j->media_size - at;
+		hash_update (&j->md5,s->data,k);
+		hash_update (&j->sha1,s->data,k);
+		if (s->bad) {
+			sec = at/BYTES_PER_SECTOR;
+			if (j->n_bad < EWF_MAX_LINES)
+				fprintf (j->log,"Chunk %ld (sectors %llu through %llu) %s\n",i,
+					(unsigned long long) sec,(unsigned long long)
+					(sec + (k + BYTES_PER_SECTOR - 1)/BYTES_PER_SECTOR - 1),
+					s->raw_n <= 0 ? "could not be read" : "checksum error");
+			for (; sec*BYTES_PER_SECTOR < at + k; sec++) add_to_range (j->bad,sec);
+			j->n_bad++;
+			if (s->raw_n <= 0) j->n_unread++;
+		}
+		at += k;
+		progress_add (j->progress,(k + BYTES_PER_SECTOR - 1)/BYTES_PER_SECTOR);
+		pthread_mutex_lock (&j->lock);
+		s->state = SLOT_FREE;
+		pthread_cond_broadcast (&j->wake);
+		pthread_mutex_unlock (&j->lock);
+	}
+	return NULL;
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s image.E01 [-options]\n",p);
+	printf ("-threads nnn\tCheck nnn chunks at a time (default %d)\n",EWF_THREADS);
+	printf ("-memory_mb nnn\tUse at most about nnn MB for chunks (default %d)\n",EWF_MEMORY_MB);
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tName the log file <name> (default ewfverlog.txt)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		**names = NULL,
+			*verdict,
+			hex[2*HASH_MAX_SIZE + 1],
+			stored_hex[2*HASH_MAX_SIZE + 1];
+	int		help = 0,
+			i,
+			n_names = 0,
+			n_threads = EWF_THREADS,
+			n_started = 0,
+			memory_mb = EWF_MEMORY_MB,
+			has_md5,
+			has_sha1,
+			n_bad = 0, /* checksums and digests shown to differ */
+			unverified = 0, /* something could not be checked */
+			hashing = 0;
+	long		c;
+	size64_t	media_size;
+	size32_t	chunk_size;
+	ewf_job		j;
+	ewf_slot	*s;
+	libewf_handle_t	*handle = NULL;
+	libewf_error_t	*error = NULL;
+	unsigned char	md5[HASH_MAX_SIZE],
+			sha1[HASH_MAX_SIZE],
+			stored_md5[16],
+			stored_sha1[20];
+	pthread_t	tid[EWF_MAX_THREADS],
+			hasher;
+	static time_t	from;
+	FILE		*log;
+	char		log_name[NAME_LENGTH] = "ewfverlog.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 2) help = 1;
+	for (i = 2; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-threads")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -threads option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&n_threads) != 1
+					|| n_threads < 1 || n_threads > EWF_MAX_THREADS){
+				printf ("%s: -threads must be 1 to %d\n",p[0],EWF_MAX_THREADS);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-memory_mb")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -memory_mb option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&memory_mb) != 1 || memory_mb < 1){
+				printf ("%s: -memory_mb must be at least 1\n",p[0]);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (help) {
+		print_help(p[0]);
+		return EWF_UNVERIFIED;
+	}
+
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = fopen (log_name,access);
+	if (log == NULL){
+		log = stdout;
+		printf("open of log file unsuccessful...using stdout instead\n");
+	}
+	fprintf (log,"%s compiled on %s at %s\n",SCCS_ID[0],SCCS_ID[1],SCCS_ID[2]);
+	fprintf (log,"CMD:");
+	for (i = 0; i < np; i++) fprintf (log," %s",p[i]);
+	fprintf (log,"\n");
+	fprintf (log,"Image: %s\n",p[1]);
+	fprintf (log,"libewf %s\n",libewf_get_version());
+	fprintf (log,"%s\n",ZH_H_ID);
+	fprintf (log,"Hash kernels: %s\n",hash_kernels());
+
+	if (libewf_glob (p[1],strlen(p[1]),LIBEWF_FORMAT_UNKNOWN,&names,&n_names,&error) != 1
+			|| libewf_handle_initialize (&handle,&error) != 1
+			|| libewf_handle_open (handle,names,n_names,LIBEWF_OPEN_READ,&error) != 1
+			|| libewf_handle_get_media_size (handle,&media_size,&error) != 1
+			|| libewf_handle_get_chunk_size (handle,&chunk_size,&error) != 1) {
+		ewf_error (log,"Could not open the image",&error);
+		log_close (log,from);
+		return EWF_UNVERIFIED;
+	}
+	has_md5 = libewf_handle_get_md5_hash (handle,stored_md5,16,&error) == 1;
+	if (error) libewf_error_free (&error);
+	has_sha1 = libewf_handle_get_sha1_hash (handle,stored_sha1,20,&error) == 1;
+	if (error) libewf_error_free (&error);
+
+	memset (&j,0,sizeof(j));
+	j.chunk_size = chunk_size;
+	j.media_size = media_size;
+	j.n_chunks = (media_size + chunk_size - 1)/chunk_size;
+	/* a slot is a stored chunk and its media data; keep every worker busy */
+	j.n_slots = ((off_t) memory_mb*1024*1024)/(2*(chunk_size + 16));
+	if (j.n_slots < n_threads + 2) j.n_slots = n_threads + 2;
+	j.slot = (ewf_slot *) calloc (j.n_slots,sizeof(ewf_slot));
+	if (j.slot == NULL) {
+		printf ("Unable to allocate memory!\n");
+		return EWF_UNVERIFIED;
+	}
+	for (i = 0; i < j.n_slots; i++)
+		if ((j.slot[i].raw = (unsigned char *) malloc (chunk_size + 16)) == NULL
+				|| (j.slot[i].buf = (unsigned char *) malloc (chunk_size + 16)) == NULL) {
+			printf ("Unable to allocate memory!\n");
+			return EWF_UNVERIFIED;
+		}
+	j.bad = create_range_list();
+	j.log = log;
+	hash_init (&j.md5,HASH_MD5);
+	hash_init (&j.sha1,HASH_SHA1);
+	pthread_mutex_init (&j.lock,NULL);
+	pthread_cond_init (&j.wake,NULL);
+	fprintf (log,"%d segment files, %llu bytes (%llu sectors) in %ld chunks of %u bytes\n",
+		n_names,(unsigned long long) media_size,
+		(unsigned long long) media_size/BYTES_PER_SECTOR,j.n_chunks,chunk_size);
+	fprintf (log,"%d threads, %d chunk slots (%llu KB)\n",n_threads,j.n_slots,
+		(unsigned long long) j.n_slots*2*(chunk_size + 16)/1024);
+
+	printf ("run start %s",ctime(&from));
+	j.progress = progress_start ("",0,(media_size + BYTES_PER_SECTOR - 1)/BYTES_PER_SECTOR);
+	for (i = 0; i < n_threads; i++)
+		if (pthread_create (&tid[n_started],NULL,check_thread,&j) == 0) n_started++;
+	if (n_started && pthread_create (&hasher,NULL,hash_thread,&j) == 0) hashing = 1;
+	if (!hashing) {
+		printf ("%s: could not start the threads\n",p[0]);
+		fprintf (log,"Could not start the threads\n");
+		log_close (log,from);
+		return EWF_UNVERIFIED;
+	}
+
+	/* read the stored chunks in order into the ring */
+	libewf_handle_seek_offset (handle,0,SEEK_SET,&error);
+	for (c = 0; c < j.n_chunks; c++) {
+		s = j.slot + c % j.n_slots;
+		pthread_mutex_lock (&j.lock);
+		while (s->state != SLOT_FREE) pthread_cond_wait (&j.wake,&j.lock);
+		pthread_mutex_unlock (&j.lock);
+		/* libewf 20130331: (handle, chunk_buffer, chunk_buffer_size,
+		   int8_t *is_compressed, void *checksum_buffer,
+		   uint32_t *chunk_checksum, int8_t *read_checksum, error) */
+		s->raw_n = libewf_handle_read_chunk (handle,s->raw,chunk_size + 16,
+			&s->compressed,s->sum,&s->chunk_sum,&s->read_sum,&error);
+		if (s->raw_n < 0) {
+			if (error) libewf_error_free (&error);
+			/* step over it so the next chunk reads where it should */
+			libewf_handle_seek_offset (handle,(off64_t) (c + 1)*chunk_size,SEEK_SET,&error);
+			if (error) libewf_error_free (&error);
+		}
+		pthread_mutex_lock (&j.lock);
+		s->index = c;
+		s->state = SLOT_READ;
+		pthread_cond_broadcast (&j.wake);
+		pthread_mutex_unlock (&j.lock);
+	}
+	for (i = 0; i < n_started; i++) pthread_join (tid[i],NULL);
+	pthread_join (hasher,NULL);
+	progress_end (j.progress);
+	hash_final (&j.md5,md5);
+	hash_final (&j.sha1,sha1);
+
+	/* a digest over chunks that were not read proves nothing */
+	if (j.n_unread) {
+		unverified++;
+		fprintf (log,"%ld chunks could not be read, the image is not verified\n",j.n_unread);
+	}
+	if (j.n_bad > j.n_unread) n_bad++;
+	if (j.n_bad) {
+		if (j.n_bad > EWF_MAX_LINES) fprintf (log,"... %ld bad chunks in all\n",j.n_bad);
+		print_range_list (log,"Bad chunk sectors: ",j.bad);
+		printf ("%ld chunks are bad\n",j.n_bad);
+	}
+	fprintf (log,"%ld of %ld chunks check\n",j.n_chunks - j.n_bad,j.n_chunks);
+	hash_hex (md5,16,hex);
+	if (has_md5) {
+		hash_hex (stored_md5,16,stored_hex);
+		if (strcmp (hex,stored_hex) && !j.n_unread) n_bad++;
+		fprintf (log,"MD5 %s %s (stored %s)\n",hex,
+			strcmp (hex,stored_hex) ? "differs" : "matches",stored_hex);
+	} else fprintf (log,"MD5 %s (none stored)\n",hex);
+	hash_hex (sha1,20,hex);
+	if (has_sha1) {
+		hash_hex (stored_sha1,20,stored_hex);
+		if (strcmp (hex,stored_hex) && !j.n_unread) n_bad++;
+		fprintf (log,"SHA1 %s %s (stored %s)\n",hex,
+			strcmp (hex,stored_hex) ? "differs" : "matches",stored_hex);
+	} else fprintf (log,"SHA1 %s (none stored)\n",hex);
+	if (!has_md5 && !has_sha1) {
+		unverified++;
+		fprintf (log,"No digest stored in the image to check against\n");
+	}
+	libewf_handle_close (handle,&error);
+	libewf_handle_free (&handle,&error);
+	libewf_glob_free (names,n_names,&error);
+
+	verdict = n_bad ? "Image does NOT verify" : unverified ? "Image could NOT be verified"
+		: "Image verifies";
+	printf ("%s\n",verdict);
+	fprintf (log,"%s\n",verdict);
+	log_close (log,from);
+	fprintf (log," \n \n");
+	return n_bad ? EWF_MISMATCH : unverified ? EWF_UNVERIFIED : EWF_OK;
+}
@@ -0,0 +1,503 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) hashver.c Linux Version 1.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <fcntl.h>
+# include <pthread.h>
+/*****************************************************************
+Check a disk or image against a segment manifest
+HASHVER checks a disk, or an image of one, against a manifest made by
+diskhash -manifest (see hash_manifest in zhash.h), or compares two
+manifests. Segments are checked on their own, so:
+	-disk: a pool of threads (-threads) hash segments at the same
+		time, each taking the next segment not yet taken
+	-compare: no disk is read at all
+and either way the log tells which segments (and so which sectors)
+differ, not just that something did.
+
+-tree checks the disk against the tree hash root in the manifest
+instead (see hash_tree in zhash.h): one thread reads the disk in
+order while a pool of threads hashes its leaves, one per CPU by
+default. Only if the root differs are the segments checked to find
+where.
+
+-seg_list checks only the segments listed in a file (numbers, as
+written by corrupt -manifest), so a change made by corrupt is found
+by hashing its segment rather than the whole disk.
+
+program outline
+	get command line
+	read the manifest
+	-disk: hash each segment (or each one listed) with a pool of threads
+	-compare: read the other manifest and compare the digests
+	log segments that differ and the verdict
+*****************************************************************/
+# define VER_THREADS	4	/* default number of threads */
+# define VER_MAX_THREADS 16
+# define VER_MAX_LINES	100	/* most runs of bad segments to log */
+
+# define SEG_SAME	0
+# define SEG_DIFFERS	1
+# define SEG_UNREAD	2	/* some sectors could not be read */
+# define SEG_UNCHECKED	3	/* to check, but no thread hashed it */
+
+typedef struct {
+	disk_control_ptr	d;
+	hash_manifest_ptr	m;
+	int			*todo,	/* segments to check */
+				n_todo;
+	volatile int		next;	/* next entry of todo to take */
+	unsigned char		*result; /* SEG_xxx for each segment */
+	progress_ptr		progress;
+} ver_job;
+
+/*****************************************************************
+Hash segment i of disk d with m's algorithm into digest
+	buf -- HASH_BLOCK sectors
+	returns SEG_UNREAD if any sector could not be read (it is
+	hashed as zeroes, as diskhash does), else SEG_SAME
+*****************************************************************/
+int hash_segment (disk_control_ptr d, hash_manifest_ptr m, int i,
+	unsigned char *buf, unsigned char *digest, progress_ptr progress)
+{
+	hash_ctx	h;
+	off_t		s,
+			k,
+			j,
+			end = seg_first(m,i) + seg_length(m,i);
+	int		status = SEG_SAME;
+
+	hash_init (&h,m->alg);
+	posix_fadvise (d->fd,seg_first(m,i)*BYTES_PER_SECTOR,
+		seg_length(m,i)*BYTES_PER_SECTOR,POSIX_FADV_SEQUENTIAL);
+	for (s = seg_first(m,i); s < end; s += k) {
+		k = HASH_BLOCK;
+		if (s + k > end) k = end - s;
+		if (read_sectors (d,s,k,buf)) {
+			for (j = 0; j < k; j++)
+				if (read_sectors (d,s + j,1,buf + j*BYTES_PER_SECTOR)) {
+					memset (buf + j*BYTES_PER_SECTOR,0,BYTES_PER_SECTOR);
+					status = SEG_UNREAD;
+				}
+		}
+		hash_update (&h,buf,k*BYTES_PER_SECTOR);
+		progress_add (progress,k);
+	}
+	hash_final (&h,digest);
+	return status;
+}
+
+/*****************************************************************
+Thread body: check segments until none are left
+*****************************************************************/
+void *ver_thread (void *arg)
+{
+	ver_job		*v = (ver_job *) arg;
+	unsigned char	*buf,
+			digest[HASH_MAX_SIZE];
+	int		t,
+			i;
+
+	if (posix_memalign ((void **) &buf,4096,HASH_BLOCK*BYTES_PER_SECTOR))
+		return NULL;
+	while ((t = __sync_fetch_and_add (&v->next,1)) < v->n_todo) {
+		i = v->todo[t];
+		if (hash_segment (v->d,v->m,i,buf,digest,v->progress) == SEG_UNREAD)
+			v->result[i] = SEG_UNREAD;
+		else v->result[i] = memcmp (digest,seg_digest(v->m,i),
+			hash_size(v->m->alg)) ? SEG_DIFFERS : SEG_SAME;
+	}
+	free (buf);
+	return NULL;
+}
+
+/*****************************************************************
+Check the segments in todo of disk d against manifest m with
+n_threads threads; result gets SEG_xxx for each (SEG_UNCHECKED if
+no thread got to it)
+	returns 0, or 1 if no thread could be started
+*****************************************************************/
+int check_segments (disk_control_ptr d, hash_manifest_ptr m, int *todo,
+	int n_todo, int n_threads, unsigned char *result)
+{
+	ver_job		v;
+	pthread_t	t[VER_MAX_THREADS];
+	off_t		total = 0;
+	int		i,
+			n = 0;
+
+	/* a thread that fails leaves its segments failed, not the same */
+	for (i = 0; i < n_todo; i++) result[todo[i]] = SEG_UNCHECKED;
+
+	v.d = d;
+	v.m = m;
+	v.todo = todo;
+	v.n_todo = n_todo;
+	v.next = 0;
+	v.result = result;
+	if (n_threads > VER_MAX_THREADS) n_threads = VER_MAX_THREADS;
+	for (i = 0; i < n_todo; i++) total += seg_length(m,todo[i]);
+	v.progress = progress_start ("",0,total);
+	for (i = 0; i < n_threads; i++)
+		if (pthread_create (&t[n],NULL,ver_thread,&v) == 0) n++;
+	for (i = 0; i < n; i++) pthread_join (t[i],NULL);
+	progress_end (v.progress);
+	return n ? 0 : 1;
+}
+
+/*****************************************************************
+Log each run of segments with the given result
+	returns the number of segments with that result
+*****************************************************************/
+int log_segments (FILE *log, hash_manifest_ptr m, unsigned char *result,
+	int what, char *caption)
+{
+	int	i,
+		j,
+		n = 0,
+		lines = 0;
+
+	for (i = 0; i < m->n_segs; i = j) {
+		if (result[i] != what) {
+			j = i + 1;
+			continue;
+		}
+		for (j = i; j < m->n_segs && result[j] == what; j++) n++;
+		if (++lines <= VER_MAX_LINES)
+			fprintf (log,"Segments %d-%d (lba %llu through %llu) %s\n",i,j - 1,
+				seg_first(m,i),seg_first(m,j - 1) + seg_length(m,j - 1) - 1,
+				caption);
+	}
+	if (lines > VER_MAX_LINES)
+		fprintf (log,"... %d more runs of segments %s\n",lines - VER_MAX_LINES,caption);
+	return n;
+}
+
+/*****************************************************************
+Read manifest file name
+*****************************************************************/
+hash_manifest_ptr load_manifest (char *name)
+{
+	FILE			*f;
+	hash_manifest_ptr	m;
+
+	f = fopen (name,"r");
+	if (f == NULL) {
+		printf ("Could not open manifest %s\n",name);
+		return NULL;
+	}
+	m = manifest_read (f);
+	fclose (f);
+	if (m == NULL) printf ("%s is not a segment manifest\n",name);
+	return m;
+}
+
+/*****************************************************************
+Read the segment numbers in file name into todo, each once
+	returns how many, or -1 if the file can not be read or
+	names a segment m does not have
+*****************************************************************/
+int load_seg_list (char *name, hash_manifest_ptr m, int *todo)
+{
+	FILE		*f;
+	unsigned char	*seen;
+	int		i,
+			n = 0;
+
+	f = fopen (name,"r");
+	if (f == NULL) {
+		printf ("Could not open segment list %s\n",name);
+		return -1;
+	}
+	seen = (unsigned char *) calloc (m->n_segs,1);
+	while (n >= 0 && fscanf (f,"%d",&i) == 1) {
+		if (i < 0 || i >= m->n_segs) {
+			printf ("Segment %d in %s is not in the manifest\n",i,name);
+			n = -1;
+		} else if (!seen[i]) {
+			seen[i] = 1;
+			todo[n++] = i;
+		}
+	}
+	if (n >= 0 && !feof (f)) {
+		printf ("%s is not a list of segment numbers\n",name);
+		n = -1;
+	}
+	fclose (f);
+	free (seen);
+	return n;
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s test-case host operator manifest -disk <drive or image> | -compare <manifest> [-options]\n",p);
+	printf ("-disk <name>\tCheck disk or image <name> against the manifest\n");
+	printf ("-compare <name>\tCompare the manifest with manifest <name>\n");
+	printf ("-threads nnn\tHash nnn segments (or tree leaves) at a time (default %d)\n",VER_THREADS);
+	printf ("-tree\tCheck the disk against the manifest's tree hash root\n");
+	printf ("-seg_list <name>\tCheck only the segments listed in <name> (see corrupt -manifest)\n");
+	printf ("-comment \" ... \"\tGive a comment on command line\n");
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tUse a different log file (default is hashverlog.txt)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		drive[NAME_LENGTH] = "",
+			other[NAME_LENGTH] = "",
+			seg_list[NAME_LENGTH] = "",
+			hex[2*HASH_MAX_SIZE + 1];
+	int		help = 0,
+			status,
+			i,
+			n_threads = 0, /* default: VER_THREADS, one per CPU for -tree */
+			n_bad,
+			n_unread = 0,
+			n_unchecked = 0,
+			tree = 0,
+			n_todo,
+			*todo;
+	unsigned char	*result;
+	hash_manifest_ptr m,
+			m2;
+	disk_hash	h;
+	progress_ptr	progress;
+	disk_control_ptr d;
+	static time_t	from;
+	FILE		*log;
+	char		comment[NAME_LENGTH] = "",
+			log_name[NAME_LENGTH] = "hashverlog.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 5) help = 1;
+	for (i = 5; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-comment")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -comment option requires a comment\n",p[0]);
+				help = 1;
+			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-disk")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -disk option requires a drive or image\n",p[0]);
+				help = 1;
+			} else strncpy(drive, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-compare")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -compare option requires a manifest\n",p[0]);
+				help = 1;
+			} else strncpy(other, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-tree")== 0) tree = 1;
+		else if (strcmp (p[i],"-seg_list")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -seg_list option requires a file name\n",p[0]);
+				help = 1;
+			} else strncpy(seg_list, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-threads")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -threads option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&n_threads) != 1
+					|| n_threads < 1 || n_threads > VER_MAX_THREADS){
+				printf ("%s: -threads must be 1 to %d\n",p[0],VER_MAX_THREADS);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (!help && !drive[0] == !other[0]) {
+		printf ("%s: give one of -disk or -compare\n",p[0]);
+		help = 1;
+	}
+	if (!n_threads) n_threads = tree ? sysconf (_SC_NPROCESSORS_ONLN) : VER_THREADS;
+	if (tree && !drive[0]) {
+		printf ("%s: -tree needs -disk\n",p[0]);
+		help = 1;
+	}
+	if (seg_list[0] && (tree || !drive[0])) {
+		printf ("%s: -seg_list needs -disk and not -tree\n",p[0]);
+		help = 1;
+	}
+	if (help) {
+		print_help(p[0]);
+		return 1;
+	}
+	if ((m = load_manifest (p[4])) == NULL) return 1;
+	if (tree && !m->tree_leaf) {
+		printf ("%s: manifest %s has no tree hash root\n",p[0],p[4]);
+		return 1;
+	}
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = log_open(log_name,access,comment,SCCS_ID,np,p);
+	fprintf (log,"Manifest %s of %s: %llu sectors from %llu, %d segments of %llu sectors, %s\n",
+		p[4],m->dev,m->n_sectors,m->first,m->n_segs,m->seg,hash_name(m->alg));
+	result = (unsigned char *) calloc (m->n_segs,1);
+	todo = (int *) malloc (m->n_segs*sizeof(int));
+	if (result == NULL || todo == NULL) {
+		printf ("Unable to allocate memory!\n");
+		fprintf (log,"Unable to allocate memory!\n");
+		return 1;
+	}
+	n_todo = m->n_segs;
+	if (seg_list[0]) {
+		n_todo = load_seg_list (seg_list,m,todo);
+		if (n_todo < 0) {
+			fprintf (log,"Bad segment list %s\n",seg_list);
+			log_close (log,from);
+			return 1;
+		}
+		fprintf (log,"Check %d segments listed in %s\n",n_todo,seg_list);
+	}
+
+	if (other[0]) {
+		if ((m2 = load_manifest (other)) == NULL) {
+			fprintf (log,"%s is not a segment manifest\n",other);
+			return 1;
+		}
+		fprintf (log,"Compare with %s of %s\n",other,m2->dev);
+		if (m2->first != m->first || m2->n_sectors != m->n_sectors
+				|| m2->seg != m->seg || m2->alg != m->alg) {
+			printf ("%s: the manifests have different layouts\n",p[0]);
+			fprintf (log,"The manifests have different layouts: %llu sectors from %llu, segments of %llu sectors, %s\n",
+				m2->n_sectors,m2->first,m2->seg,hash_name(m2->alg));
+			log_close (log,from);
+			return 1;
+		}
+		for (i = 0; i < m->n_segs; i++)
+			result[i] = memcmp (seg_digest(m,i),seg_digest(m2,i),
+				hash_size(m->alg)) ? SEG_DIFFERS : SEG_SAME;
+		fprintf (log,"Total %s %s\n",hash_hex (m->total,hash_size(m->alg),hex),
+			memcmp (m->total,m2->total,hash_size(m->alg)) ? "differs" : "matches");
+	} else {
+		d = open_image (drive,&status);
+		if (status){
+			printf ("%s could not access drive %s status code %d\n",
+				p[0],drive,status);
+			fprintf (log,"%s could not access drive %s status code %d\n",
+				p[0],drive,status);
+			return 1;
+		}
+		log_disk (log,"Check",d);
+		fprintf (log,"Hash kernels: %s\n",hash_kernels());
+		if (m->first + m->n_sectors > n_sectors(d)) {
+			printf ("%s: %s is smaller than the manifest\n",p[0],drive);
+			fprintf (log,"%s has %llu sectors, the manifest needs %llu\n",
+				drive,n_sectors(d),m->first + m->n_sectors);
+			log_close (log,from);
+			return 1;
+		}
+		if (tree) {
+			memset (&h,0,sizeof(h));
+			h.tree = tree_create (m->alg,m->first,m->n_sectors,m->tree_leaf,n_threads);
+			if (h.tree == NULL) {
+				printf ("Unable to allocate memory!\n");
+				fprintf (log,"Unable to allocate memory!\n");
+				return 1;
+			}
+			fprintf (log,"Tree hash, %ld leaves, %d threads\n",h.tree->n_leaves,
+				h.tree->n_threads);
+			progress = progress_start ("",m->first,m->first + m->n_sectors);
+			status = hash_disk (d,m->first,m->n_sectors,&h,progress);
+			progress_end (progress);
+			if (!status && !h.n_error
+				&& !memcmp (h.tree->root,m->tree_root,hash_size(m->alg))) {
+				fprintf (log,"Tree root %s matches\n",
+					hash_hex (m->tree_root,hash_size(m->alg),hex));
+				fprintf (log,"%s matches manifest %s\n",drive,p[4]);
+				printf ("Tree root matches: %s matches manifest %s\n",drive,p[4]);
+				log_close (log,from);
+				return 0;
+			}
+			fprintf (log,"Tree root %s differs, checking segments\n",
+				hash_hex (h.tree->root,hash_size(m->alg),hex));
+		}
+		if (!seg_list[0]) for (i = 0; i < m->n_segs; i++) todo[i] = i;
+		fprintf (log,"%d threads\n",n_threads);
+		if (check_segments (d,m,todo,n_todo,n_threads,result)) {
+			printf ("%s: could not start any threads\n",p[0]);
+			fprintf (log,"Could not start any threads\n");
+			return 1;
+		}
+		n_unread = log_segments (log,m,result,SEG_UNREAD,"could not all be read");
+		n_unchecked = log_segments (log,m,result,SEG_UNCHECKED,"were not checked");
+		n_unread += n_unchecked;
+	}
+
+	n_bad = log_segments (log,m,result,SEG_DIFFERS,"differ");
+	fprintf (log,"%d of %d segments %sdiffer\n",n_bad,n_todo,seg_list[0] ? "checked " : "");
+	if (n_unread - n_unchecked)
+		fprintf (log,"%d segments could not all be read\n",n_unread - n_unchecked);
+	if (n_unchecked) fprintf (log,"%d segments were not checked\n",n_unchecked);
+	fprintf (log,"%s %s manifest %s\n",other[0] ? other : drive,
+		n_bad + n_unread ? "does NOT match" : "matches",p[4]);
+	printf ("%d of %d segments %sdiffer: %s %s manifest %s\n",n_bad + n_unread,
+		n_todo,seg_list[0] ? "checked " : "",other[0] ? other : drive,
+		n_bad + n_unread ? "does NOT match" : "matches",p[4]);
+	log_close (log,from);
+	return n_bad + n_unread ? 1 : 0;
+}
@@ -32,6 +32,7 @@ redistribution.
 # include "zbios.h"   
 # include <malloc.h>
 # include <time.h>
+# include <pthread.h>
 
 /******************************************************************************
 Print a partition table
@@ -40,8 +41,27 @@ Print a partition table
 	log disk
 	print partition table
 	close log
+
+Several drives can be given (-drive). The drives are opened and their
+partition tables read at the same time, one thread per drive; then each
+drive is logged in turn. Besides the text table, a partition table
+record (see save_partition_table) is written for each drive so that
+partcmp and adjcmp can load it (-table) instead of reading the disk.
 ******************************************************************************/
 
+# define MAX_DRIVES 16
+
+typedef struct { /* one drive to examine */
+	char		*drive, /* device name */
+			*label; /* drive label from command line */
+	disk_control_ptr dd;
+	int		open_status, /* open_disk status */
+			status; /* get_partition_table status */
+	pte_rec		pt[4];
+	pthread_t	thread;
+	int		thread_started;
+} drive_rec;
+
 
 /*	Helper function
 	return index of filename, without leading path information
@@ -58,6 +78,19 @@ char * filename(char* path) {
 	return path;
 }
 
+/******************************************************************************
+Thread body: open a drive and read its partition table
+******************************************************************************/
+void *probe_drive (void *arg)
+{
+	drive_rec	*r = (drive_rec *) arg;
+
+	r->status = 1;
+	r->dd = open_disk (r->drive,&r->open_status);
+	if (r->open_status == 0) r->status = get_partition_table(r->dd,r->pt);
+	return NULL;
+}
+
 void print_help(char *p /* program name */)
 {
 	static int been_here = 0;
@@ -66,25 +99,32 @@ void print_help(char *p /* program name */)
 
 	printf ("Usage: %s test-case host operator drive label [-options]\n",p);
 	printf ("-all\tList extended partitions\n");
+	printf ("-drive <drive> <label>\tAlso examine <drive> (may be repeated)\n");
 	printf ("-comment \" ... \"\tComment for log file\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse a different log file (default is pt-label-log.txt\n\tand is written to the current directory)\n");
+	printf ("-table <file>\tAdd the partition tables to <file> for use by partcmp and adjcmp\n\t(default is pt-label-table.txt for each drive)\n");
 	printf ("-h\tPrint this option list\n");
 }
 
 int main (int np, char **p)
 {
-	char		drive[NAME_LENGTH] = "/dev/hda";
 	int		lname_given = 0,
 			status,
 			i,
-			all,
+			k,
+			n_drives = 0,
+			n_bad = 0, /* drives that could not be opened */
+			all = 0,
 			help = 0;
-	static disk_control_block *dd;
-	pte_rec		pt[4];
-	FILE		*log;
+	static drive_rec drives[MAX_DRIVES];
+	drive_rec	*r;
+	FILE		*log,
+			*table;
 	char		comment [NAME_LENGTH] = "",
 			log_name[NAME_LENGTH],
+			table_name[NAME_LENGTH] = "",
+			name[NAME_LENGTH],
 			access[2] = "a";
 	time_t		from;
 
@@ -95,7 +135,11 @@ int main (int np, char **p)
 
 /* get command line */
 	if (np < 6) help = 1;
-	else strncpy(drive, p[4], NAME_LENGTH - 1);
+	else {
+		drives[0].drive = p[4];
+		drives[0].label = p[5];
+		n_drives = 1;
+	}
 	for (i = 6; i < np; i++){
 		if (strcmp(p[i],"-all") == 0) all = 1;
 		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
@@ -107,6 +151,24 @@ int main (int np, char **p)
 				sprintf (log_name,"%s",p[i]);
 				lname_given = 1;
 			}
+		} else if (strcmp (p[i],"-table")== 0) {
+			if(++i >= np) {
+				printf("%s: -table option requires a file name\n", p[0]);
+				help = 1;
+			} else strncpy (table_name, p[i], NAME_LENGTH - 1);
+		} else if (strcmp (p[i],"-drive")== 0) {
+			i += 2;
+			if (i >= np) {
+				printf("%s: -drive option requires a drive and a label\n", p[0]);
+				help = 1;
+			} else if (n_drives >= MAX_DRIVES) {
+				printf("%s: at most %d drives\n", p[0], MAX_DRIVES);
+				help = 1;
+			} else {
+				drives[n_drives].drive = p[i-1];
+				drives[n_drives].label = p[i];
+				n_drives++;
+			}
 		} else if (strcmp(p[i],"-comment") == 0) {
 			i++;
 			if (i < np) strncpy (comment, p[i], NAME_LENGTH - 1);
@@ -120,33 +182,59 @@ int main (int np, char **p)
 		print_help(p[0]);
 		return 0;
 	}
-	status = 1;
-	printf ("Drive %s\n",drive);
+
+/* open the drives and get the partition tables, all drives at once */
+	for (k = 0; k < n_drives; k++) {
+		printf ("Drive %s\n",drives[k].drive);
+		if (pthread_create (&drives[k].thread, NULL, probe_drive, &drives[k]))
+			probe_drive (&drives[k]); /* no thread: do it here */
+		else drives[k].thread_started = 1;
+	}
+	for (k = 0; k < n_drives; k++)
+		if (drives[k].thread_started) pthread_join (drives[k].thread, NULL);
+
+/* log each drive in turn */
+	for (k = 0; k < n_drives; k++) {
+		r = &drives[k];
+		status = r->status;
 /* open log file */
-	if (lname_given == 0) sprintf (log_name,"pt-%s-log.txt", filename(&p[4][5]));
-
-	log = log_open (log_name,access,comment,SCCS_ID,np,p);
-
-/* open and log disk */
-	dd = open_disk (drive,&status);
-	if (status) {
-		printf ("%s could not access drive %s, status code %d\n",p[0],
-			drive,status); 
-		fprintf (log,"%s could not access drive %s, status code %d\n",p[0],
-			drive,status);
-		return 1;
+		if (lname_given == 0) sprintf (log_name,"pt-%s-log.txt", filename(&r->drive[5]));
+
+		log = log_open (log_name,access,comment,SCCS_ID,np,p);
+
+/* log disk */
+		if (r->open_status) {
+			printf ("%s could not access drive %s, status code %d\n",p[0],
+				r->drive,r->open_status); 
+			fprintf (log,"%s could not access drive %s, status code %d\n",p[0],
+				r->drive,r->open_status);
+			if (log != stdout) fclose (log);
+			n_bad++;
+			continue;
+		}
+		fprintf (log,"Drive label: %s\n",r->label);
+		log_disk (log,"Partition table",r->dd);
+
+/* print partition table */
+		if (status == 0) print_partition_table(stdout, r->pt, 1, all);
+		else if (status == -1) printf ("No partition table signature\n");
+		else printf ("Error reading partition table, code %d\n",status);
+
+		if (status == 0) print_partition_table(log, r->pt, 1, all);
+		if (status)fprintf (log,"Error reading partition table, code %d\n",status);
+
+/* save partition table record */
+		if (table_name[0]) strcpy (name, table_name);
+		else sprintf (name,"pt-%s-table.txt", filename(&r->drive[5]));
+		if ((table = fopen (name, table_name[0] ? "a" : access)) == NULL)
+			printf ("Could not open partition table file %s\n",name);
+		else {
+			save_partition_table (table,r->dd);
+			fclose (table);
+		}
+		log_close (log,from);
+		if (log != stdout) fclose (log);
+		if (access[0] == 'w' && lname_given) access[0] = 'a'; /* one log for all drives */
 	}
-	fprintf (log,"Drive label: %s\n",p[5]);
-	log_disk (log,"Partition table",dd);
-
-/* get and print partition table */
-	status = get_partition_table(dd,pt);
-	if (status == 0) print_partition_table(stdout, pt, 1, all);
-	else if (status == -1) printf ("No partition table signature\n");
-	else printf ("Error reading partition table, code %d\n",status);
-
-	if (status == 0) print_partition_table(log, pt, 1, all);
-	if (status)fprintf (log,"Error reading partition table, code %d\n",status);
-	log_close (log,from);
-	return 0;
+	return n_bad ? 1 : 0;
 }
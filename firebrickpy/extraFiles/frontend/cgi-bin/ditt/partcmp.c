@@ -30,6 +30,7 @@ redistribution.
 # include "zbios.h"
 # include <string.h> 
 # include <malloc.h>
+# include <stdlib.h>
 # include <time.h>
 static char *SCCS_ID[] = {"@(#) partcmp.c Linux Version 1.3 Created 03/15/05 at 17:25:33",
 				__DATE__,__TIME__};
@@ -88,8 +89,9 @@ p is the partition table entries list
 ix identifies the desired partition table entry
 base returns the LBA address of the start of the partition
 n returns the number of sectors in the partition
+type returns the partition type code (if type is not NULL)
 *****************************************************************/
-int get_partition_offset (pte_ptr p, int ix, off_t *base, off_t *n) {
+int get_partition_offset (pte_ptr p, int ix, off_t *base, off_t *n, unsigned char *type) {
 	off_t		pt_base;
 	int		at = 1,
 			i;
@@ -99,6 +101,7 @@ int get_partition_offset (pte_ptr p, int ix, off_t *base, off_t *n) {
 		if (at == ix) { /* found desired entry */
 			*base = p[i].lba_start;
 			*n = p[i].lba_length;
+			if (type) *type = p[i].type;
 			return 0;
 		}
 		/* If this is an extended PTE look inside */
@@ -110,6 +113,7 @@ int get_partition_offset (pte_ptr p, int ix, off_t *base, off_t *n) {
 			if (at == ix) { /* found the desired entry */
 				*base = pt_base + sub->lba_start;
 				*n = sub->lba_length;
+				if (type) *type = sub->type;
 				return 0;
 			}
 			at++;
@@ -133,17 +137,19 @@ drive is the disk to open
 caption is either "source" or "destination" (for log file)
 log is the log file
 p is the command line
+table is a file of saved partition tables (from partab -table) or NULL
 ask_for_partitions = true => do dialog to get partition index
-px is the partition index (if supplied on command line)
+px is the partition index (if supplied on command line), 0 => all partitions
+pt returns the partition table
 return base -- partition base address (LBA)
 return n -- number of sectors in partition
 return disk -- disk control pointer to access drive
 *****************************************************************/
-int setup_disk (char* drive, char *caption, FILE *log, char **p, int ask_for_partitions,
-		 int px, off_t *base, off_t *n, disk_control_ptr *disk)
+int setup_disk (char* drive, char *caption, FILE *log, char **p, FILE *table,
+		 int ask_for_partitions, int px, pte_ptr pt, off_t *base, off_t *n,
+		 disk_control_ptr *disk)
 {
 	int	status;
-	static	pte_rec pt[4];
 
 	*disk = open_disk (drive,&status);
 	if (status) {
@@ -151,12 +157,22 @@ int setup_disk (char* drive, char *caption, FILE *log, char **p, int ask_for_par
 		fprintf (log,"%s could not open drive %s, status code %d\n", p[0], drive, status);
 		return 1;
 	}
+	if (table) {
+		rewind (table);
+		if (load_partition_table (table, *disk) == 0)
+			fprintf (log,"%s partition table from saved table\n", caption);
+	}
 	status = get_partition_table(*disk,pt);
 	if (status) {
 		printf ("Could not read %s partition table on drive %s\n", caption, drive);
 		fprintf (log,"Could not read %s partition table on drive %s\n", caption, drive);
 		return 1;
 	}
+	if (px == 0) { /* every partition: just log the disk and table */
+		log_disk (log, caption, *disk);
+		print_partition_table(log, pt, 1, 1);
+		return 0;
+	}
 	if (ask_for_partitions) { /* ask if not given on command line */
 		print_partition_table(stdout, pt, 1, 1);
 		printf("Select partition: ");
@@ -164,7 +180,7 @@ int setup_disk (char* drive, char *caption, FILE *log, char **p, int ask_for_par
 		printf("\nPartition %d selected.\n", px);
 	}
 
-	status = get_partition_offset (pt, px, base, n);
+	status = get_partition_offset (pt, px, base, n, NULL);
 	if (status) {
 		printf ("Could not find %s partition %d\n", caption, px);
 		return 1;
@@ -176,6 +192,364 @@ int setup_disk (char* drive, char *caption, FILE *log, char **p, int ask_for_par
 	fprintf (log,"%s partition %d at %llu for %llu\n", caption, px, *base, *n);
 	return 0;
 }
+
+/*****************************************************************
+Counts from comparing one pair of partitions
+*****************************************************************/
+typedef struct {
+	off_t	common, /* number of sectors common to source & destination */
+		match, /* number of matching sectors */
+		diffs, /* count of sectors that don't match */
+		byte_diffs, /* count of bytes that differ between src and dst */
+		/* zero .. other apply to dst sectors beyond common area */
+		zero, /* number of zero filled sectors */
+		sfill, /* number of sectors filled with src fill char */
+		dfill, /* number of sectors filled with dst fill char */
+		ofill, /* number of sectors filled with some other fill char */
+		other; /* number of remaining (unfilled) sectors */
+} part_result;
+
+# define PART_BLOCK 2048 /* sectors per read request (1 MB) */
+
+/*****************************************************************
+Compare one source partition to one destination partition and log
+the results. The partitions are read PART_BLOCK sectors at a time;
+if a block can not be read it is read again a sector at a time so
+that errors are reported against the sector that failed.
+*****************************************************************/
+int cmp_part (disk_control_ptr src_disk, disk_control_ptr dst_disk,
+	off_t		src_base, /* LBA address of source partition */
+	off_t		src_n, /* size (number of sectors in) source partition */
+	off_t		dst_base, /* ditto dst */
+	off_t		dst_n,
+	unsigned char	src_fill_char,
+	unsigned char	dst_fill_char, /* fill characters */
+	int		boot_track_too, /* include boot track in compare */
+	int		is_debug,
+	int		log_diffs,
+	time_t		from, /* start time for progress feedback */
+	FILE		*log, /* log file */
+	part_result	*r) /* counts returned */
+{
+	static unsigned char *src_block = NULL, /* PART_BLOCK sector buffers */
+			*dst_block = NULL;
+	unsigned char	*src_buff,*dst_buff; /* current sectors */
+	off_t		lba = 0, /* a sector LBA address usually found as a loop index */
+			src_lba, /* address of current sector on source */
+			dst_lba, /* address of current sector on destination */
+			at, /* start of current block (relative to partition) */
+			k, /* sectors in current block */
+			common, /* number of sectors common to source & destination */
+			nz, /* number of zero filled bytes in a sector */
+			nfill; /* number of fill bytes in a sector */
+	int		big_src = 0, /* true if src bigger than dst */
+			big_dst = 0, /* true if dst bigger than src */
+			is_diff,
+			i;
+	int		src_status,
+			dst_status; /* I/O error returns */
+	progress_ptr	progress; /* sectors examined, for user feedback */
+	/* range_ptr is used to track a list of ranges. In this case the ranges
+	are disk areas specified in LBA addresses */
+	range_ptr	d_r = create_range_list(), /* common area sectors that don't match */
+			zf_r = create_range_list(), /* zero filled sectors */
+			sf_r = create_range_list(), /* sectors with src-fill */
+			df_r = create_range_list(), /* sectors with dst-fill */
+			of_r = create_range_list(), /* sectors with some other fill */
+			o_r = create_range_list(); /* other (unfilled) sectors */
+
+	memset (r, 0, sizeof(part_result));
+	if (src_block == NULL) {
+		src_block = (unsigned char *) malloc (PART_BLOCK*BYTES_PER_SECTOR);
+		dst_block = (unsigned char *) malloc (PART_BLOCK*BYTES_PER_SECTOR);
+		if ((src_block == NULL) || (dst_block == NULL)) {
+			printf ("Unable to allocate memory!\n");
+			return 1;
+		}
+	}
+/*****************************************************************
+get ready to do the compare
+see which is bigger: src or dst
+*****************************************************************/
+	if (src_n != dst_n) {
+		if ( src_n < dst_n) {
+			common = src_n;
+			big_dst = 1;
+		} else {
+			common = dst_n;
+			big_src = 1;
+		}
+	} else common = src_n;
+	src_lba = src_base;
+	dst_lba = dst_base;
+	if (boot_track_too) {
+		common += 63;
+		src_lba -= 63;
+		dst_lba -= 63;
+		src_base -= 63;
+		dst_base -= 63;
+		src_n += 63;
+		dst_n += 63;
+	}
+	fprintf (log,"Source base sector %llu Destination base sector %llu\n",
+		src_base,dst_base); 
+	progress = progress_start ("", 0, big_dst ? dst_n : common);
+/*****************************************************************
+Main compare loop:
+	for each block of sectors in common
+		read src block
+		read dst block
+		for each sector in the block
+			if match then increment match count
+			else increment different count
+*****************************************************************/
+	for (at = 0; at < common; at += k) {
+		k = common - at;
+		if (k > PART_BLOCK) k = PART_BLOCK;
+		src_status = read_sectors(src_disk, src_lba, k, src_block);
+		dst_status = read_sectors(dst_disk, dst_lba, k, dst_block);
+		progress_add (progress, k); /* give progress feedback to user */
+		for (lba = at; lba < at + k; lba++) {
+			is_diff = 0;
+			if (src_status || dst_status) { /* find the sector that failed */
+				src_status = read_lba(src_disk, src_lba, &src_buff);
+				dst_status = read_lba(dst_disk, dst_lba, &dst_buff);
+				if (src_status || dst_status) {
+					fprintf (log,"read error at sector %llu: src %d dst %d\n", lba, src_status, dst_status);
+					printf ("read error at lba %llu: src %d dst %d\n", lba, src_status, dst_status);
+					progress_end (progress);
+					return 1;
+				}
+				src_status = dst_status = 1; /* rest of block one at a time too */
+			} else {
+				src_buff = src_block + (lba - at)*BYTES_PER_SECTOR;
+				dst_buff = dst_block + (lba - at)*BYTES_PER_SECTOR;
+			}
+			src_lba++;
+			dst_lba++;
+/*****************************************************************
+Compare corresponding sectors
+*****************************************************************/
+
+			for (i = 0; i < BYTES_PER_SECTOR; i++) {
+				if (src_buff[i] != dst_buff[i]) {
+					is_diff = 1;
+					r->byte_diffs++;
+				}
+			}
+			if (is_diff) {
+				r->diffs++;
+				add_to_range (d_r,lba);
+				if (log_diffs && (r->diffs <= 50)) {
+					 fprintf (log,"%12llu ",lba);
+					 if ((r->diffs%5) == 0) fprintf (log,"\n");
+				}
+			}
+			else {
+				r->match++;
+			}
+		}
+	}
+	r->common = common;
+/*****************************************************************
+Log results for corresponding sectors
+*****************************************************************/
+
+	if  (log_diffs && (r->diffs)) fprintf (log,"\n");
+	fprintf (log,"Sectors compared: %12llu\n",common);
+	fprintf (log,"Sectors match:    %12llu\n",r->match);
+	fprintf (log,"Sectors differ:   %12llu\n",r->diffs);
+	fprintf (log,"Bytes differ:     %12llu\n",r->byte_diffs);
+	print_range_list(log,"Diffs range: ",d_r);
+	if (big_src) {
+		fprintf (log,"Source (%llu) has %llu more sectors than destination (%llu)\n", src_n, src_n - dst_n, dst_n);
+	}
+/*****************************************************************
+If the destination is larger than the source then
+	look at the remainder of the destination
+*****************************************************************/
+	else if (big_dst) {
+		fprintf (log,"Source (%llu) has %llu fewer sectors than destination (%llu)\n", src_n, dst_n - src_n, dst_n);
+		printf ("Destination larger than source; scanning %llu sectors\n", dst_n-common);
+		for (at = common; at < dst_n; at += k) {
+			k = dst_n - at;
+			if (k > PART_BLOCK) k = PART_BLOCK;
+			dst_status = read_sectors(dst_disk, dst_lba, k, dst_block);
+			progress_add (progress, k);
+			for (lba = at; lba < at + k; is_debug?(lba+=100):lba++){
+				if (dst_status) {
+					if((dst_status = read_lba(dst_disk, dst_lba + (lba - at), &dst_buff))) {
+						fprintf (log,"read error at sector %llu: dst %d\n", lba, dst_status);
+						printf ("read error at lba %llu: dst %d\n", lba, dst_status);
+					}
+					dst_status = 1; /* rest of block one at a time too */
+				} else dst_buff = dst_block + (lba - at)*BYTES_PER_SECTOR;
+				nz = 0;
+				nfill = 0; 
+/*****************************************************************
+classify sector: count zero bytes and fill bytes
+how to count fill bytes? the rule is: all bytes after
+byte [23] are the same. i.e., 488 bytes of the sector are the
+same. We use 480 to give some slack.
+*****************************************************************/
+
+				for (i = 0; i < BYTES_PER_SECTOR; i++) {
+					if ( dst_buff[i] == 0) nz++;
+					else if (dst_buff[i] == dst_buff[BUFF_OFF]) nfill++;
+				}
+				if (nz == BYTES_PER_SECTOR) { r->zero++; add_to_range(zf_r,lba); }
+				else if (nfill > 480) {
+						if (dst_buff[BUFF_OFF] == src_fill_char) {
+							r->sfill++;
+							add_to_range(sf_r,lba);
+						} else if (dst_buff[BUFF_OFF] == dst_fill_char) {
+							r->dfill++;
+							add_to_range(df_r,lba);
+						} else {
+							r->ofill++;
+							add_to_range(of_r,lba);
+						}
+				}
+				else {
+					r->other++;
+					add_to_range (o_r,lba);
+				}
+			}
+			dst_lba += k;
+		}
+/*****************************************************************
+log results to log file
+*****************************************************************/
+		if  (log_diffs && (r->other)) fprintf (log, "\n");
+		fprintf (log,"Zero fill:     %llu\n", r->zero);
+		fprintf (log,"Src Byte fill (%02X): %llu\n", src_fill_char, r->sfill);
+		if (src_fill_char == dst_fill_char)
+			fprintf (log, "Dst Fill Byte same as Src Fill Byte\n");
+		else fprintf (log, "Dst Byte fill (%02X): %lu\n", dst_fill_char, r->dfill);
+		fprintf (log,"Other fill:    %llu\n", r->ofill);
+		fprintf (log,"Other no fill: %llu\n", r->other);
+		print_range_list(log,"Zero fill range: ", zf_r);
+		print_range_list(log,"Src fill range: ", sf_r);
+		print_range_list(log,"Dst fill range: ", df_r);
+		print_range_list(log,"Other fill range: ", of_r);
+		print_range_list(log,"Other not filled range: ", o_r);
+	}
+	progress_end (progress);
+	free (d_r);
+	free (zf_r);
+	free (sf_r);
+	free (df_r);
+	free (of_r);
+	free (o_r);
+	return 0;
+}
+
+/*****************************************************************
+A partition selected for the all partitions compare
+*****************************************************************/
+typedef struct {
+	int	ix; /* partition table index (as printed by print_partition_table) */
+	off_t	src_base, src_n,
+		dst_base, dst_n;
+} part_pair;
+
+int cmp_part_pair (const void *a, const void *b)
+{
+	const part_pair	*x = a, *y = b;
+
+	if (x->src_base == y->src_base) return 0;
+	return (x->src_base < y->src_base)?-1:1;
+}
+
+/*****************************************************************
+Compare every partition found on both disks (-all)
+Partitions are matched by table index. Empty entries and extended
+partition entries are skipped. The matched partitions are compared
+in source LBA order so the whole disk is read front to back in one
+pass. Each partition gets its own section in the log followed by a
+summary for the whole disk.
+*****************************************************************/
+int cmp_all_parts (disk_control_ptr src_disk, disk_control_ptr dst_disk,
+	pte_ptr		src_pt,
+	pte_ptr		dst_pt, /* partition tables */
+	unsigned char	src_fill_char,
+	unsigned char	dst_fill_char, /* fill characters */
+	int		boot_track_too, /* include boot track in compare */
+	int		is_debug,
+	int		log_diffs,
+	FILE		*log) /* log file */
+{
+	part_pair	pp[MAX_PARTITIONS];
+	part_result	r,
+			total; /* sums over all partitions */
+	int		n = 0, /* number of matched partitions */
+			ix, /* partition table index */
+			i,
+			n_same = 0, /* partitions that compare equal */
+			n_skip = 0, /* partitions on only one disk */
+			src_more, dst_more, /* more entries in src/dst tables */
+			status;
+	off_t		src_base, src_n,
+			dst_base, dst_n;
+	unsigned char	src_type, dst_type;
+	time_t		start;
+
+	memset (&total, 0, sizeof(part_result));
+	fprintf (log,"Compare all partitions\n");
+	for (ix = 1; n < MAX_PARTITIONS; ix++) {
+		src_more = !get_partition_offset (src_pt, ix, &src_base, &src_n, &src_type);
+		dst_more = !get_partition_offset (dst_pt, ix, &dst_base, &dst_n, &dst_type);
+		if (!src_more && !dst_more) break;
+		if (src_more && (!src_type || is_extended(src_type))) src_more = 0;
+		if (dst_more && (!dst_type || is_extended(dst_type))) dst_more = 0;
+		if (src_more && dst_more) {
+			pp[n].ix = ix;
+			pp[n].src_base = src_base;
+			pp[n].src_n = src_n;
+			pp[n].dst_base = dst_base;
+			pp[n].dst_n = dst_n;
+			n++;
+		} else if (src_more || dst_more) {
+			fprintf (log,"Partition %d only on %s: not compared\n", ix,
+				src_more ? "source" : "destination");
+			printf ("Partition %d only on %s: not compared\n", ix,
+				src_more ? "source" : "destination");
+			n_skip++;
+		}
+	}
+	qsort (pp, n, sizeof(part_pair), cmp_part_pair);
+
+	for (i = 0; i < n; i++) {
+		printf ("Partition %d: source at %llu for %llu, destination at %llu for %llu\n",
+			pp[i].ix, pp[i].src_base, pp[i].src_n, pp[i].dst_base, pp[i].dst_n);
+		fprintf (log,"\n==== Partition %d: source at %llu for %llu, destination at %llu for %llu\n",
+			pp[i].ix, pp[i].src_base, pp[i].src_n, pp[i].dst_base, pp[i].dst_n);
+		time(&start);
+		status = cmp_part (src_disk, dst_disk, pp[i].src_base, pp[i].src_n,
+			pp[i].dst_base, pp[i].dst_n, src_fill_char, dst_fill_char,
+			boot_track_too, is_debug, log_diffs, start, log, &r);
+		if (status) return status;
+		if ((r.diffs == 0) && (pp[i].src_n == pp[i].dst_n)) n_same++;
+		total.common += r.common;
+		total.match += r.match;
+		total.diffs += r.diffs;
+		total.byte_diffs += r.byte_diffs;
+	}
+
+/*****************************************************************
+log combined summary
+*****************************************************************/
+	fprintf (log,"\n==== Summary of %d partitions compared\n", n);
+	fprintf (log,"Partitions same:     %12d\n", n_same);
+	fprintf (log,"Partitions differ:   %12d\n", n - n_same);
+	if (n_skip) fprintf (log,"Partitions skipped:  %12d\n", n_skip);
+	fprintf (log,"Sectors compared:    %12llu\n", total.common);
+	fprintf (log,"Sectors match:       %12llu\n", total.match);
+	fprintf (log,"Sectors differ:      %12llu\n", total.diffs);
+	fprintf (log,"Bytes differ:        %12llu\n", total.byte_diffs);
+	printf ("%d partitions compared: %d same, %d differ\n", n, n_same, n - n_same);
+	return 0;
+}
  
 /*****************************************************************
 Print usage and options
@@ -188,6 +562,7 @@ void print_help(char *p)
 
 	printf ("Usage: %s test-case host operator src-drive src-fill dst-drive dst-fill [-options]\n",p);
 	printf ("-select src dst\tSelect partitions to compare\n");
+	printf ("-all\tCompare every partition found on both disks (one pass)\n");
 	printf ("-boot\tInclude Boot track in compare\n");
 /*	printf ("               \tformat for src & dst P.N,\n");
 	printf ("               \twhere: P is primary partition number\n");
@@ -195,6 +570,7 @@ void print_help(char *p)
 	printf ("-comment \" ... \"\tDescriptive comment\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse different log file (default is cmpptlog.txt)\n");
+	printf ("-table <file>\tUse partition tables saved by partab -table\n");
 	printf ("-h\tPrint this option list\n");
 }
 
@@ -208,33 +584,17 @@ int main(int np, char **p)
 			dst_drive[NAME_LENGTH] = "/dev/hdb"; /* destination drive */
 	int		help = 0, /* set to true to indicate problem with command line */
 			ask_for_partitions = 1,	/* default is true; set to false if partitions given on command line */
+			all_partitions = 0, /* compare every partition */
 			status, /* error return on I/O operations */
 			i; /* loop index */
 	static disk_control_block *src_disk,*dst_disk;
-	static off_t	lba = 0, /* a sector LBA address usually found as a loop index */
-			common, /* number of sectors common to source & destination */
-			diffs = 0, /* count of sectors that don't match */
-			src_lba, /* address of current sector on source */
-			dst_lba,  /* address of current sector on destination */
-			byte_diffs = 0, /* count of bytes that differ between src and dst */
-			match = 0, /* number of matching sectors */
-			/* zero .. other apply to dst sectors beyond common area */
-			zero = 0, /* number of zero filled sectors */
-			sfill = 0, /* number of sectors filled with src fill char */
-			dfill = 0, /* number of sectors filled with dst fill char */
-			ofill = 0, /* number of sectors filled with some other fill char */
-			other = 0; /* number of remaining (unfilled) sectors */
-	static unsigned long nz, /* number of zero filled bytes in a sector */
-			nfill; /* number of fill bytes in a sector */
-	int		big_src = 0, /* true if src bigger than dst */
-			big_dst = 0, /* true if dst bigger than src */
-			is_diff,
-			boot_track_too = 0; /* include boot track in compare */
-	int		src_status,
-			dst_status; /* I/O error returns */
-	static unsigned char *src_buff,*dst_buff; /* sector buffers */
+	static pte_rec	src_pt[4],
+			dst_pt[4]; /* partition tables */
+	part_result	r; /* compare counts */
+	int		boot_track_too = 0; /* include boot track in compare */
 	static time_t	from; /* run start time */
-	FILE		*log; /* log file */
+	FILE		*log, /* log file */
+			*table = NULL; /* saved partition tables */
 	int		is_debug = 0,
 			log_diffs = 0;
 	unsigned char	src_fill_char,
@@ -245,14 +605,6 @@ int main(int np, char **p)
 			src_n, /* size (number of sectors in) source partition */
 		 	dst_base, /* ditto dst */
 			dst_n;
-	/* range_ptr is used to track a list of ranges. In this case the ranges
-	are disk areas specified in LBA addresses */
-	range_ptr	d_r = create_range_list(), /* common area sectors that don't match */
-			zf_r = create_range_list(), /* zero filled sectors */
-			sf_r = create_range_list(), /* sectors with src-fill */
-			df_r = create_range_list(), /* sectors with dst-fill */
-			of_r = create_range_list(), /* sectors with some other fill */
-			o_r = create_range_list(); /* other (unfilled) sectors */
 	static char	comment[NAME_LENGTH] = "",
 			log_name[NAME_LENGTH] = "cmpptlog.txt",
 			access[2] = "a";
@@ -294,12 +646,19 @@ get options from command line
 				sscanf (p[i],"%d",&dst_px);
 				ask_for_partitions = 0; /* we got 'em so don't ask */
 			}
-		} else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		} else if (strcmp (p[i],"-all") == 0) all_partitions = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
 		else if (strcmp (p[i], "-log_name") == 0) {
 			if(++i >= np) {
 				printf("%s: -log_name option requires a logfile name\n", p[0]);
 				help = 1;
 			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		} else if (strcmp (p[i],"-table")== 0) {
+			if(++i >= np) {
+				printf("%s: -table option requires a file name\n", p[0]);
+				help = 1;
+			} else if ((table = fopen (p[i],"r")) == NULL)
+				printf ("%s: could not open partition table file %s\n", p[0], p[i]);
 		} else if (strcmp (p[i],"-boot")== 0) boot_track_too = 1;
 		else if (strcmp (p[i],"-comment")== 0) {
 			i++;
@@ -323,6 +682,13 @@ get source and destination drives (in hex) from command line
 		help = 1;
 		printf ("Source and destination drives must be different\n");
 	}
+	if (all_partitions) {
+		if (!ask_for_partitions) {
+			help = 1;
+			printf ("-all and -select can not be used together\n");
+		}
+		ask_for_partitions = 0;
+	}
 
 /*****************************************************************
 If there is a problem on command line, then print help message
@@ -338,159 +704,25 @@ Open log file, source disk and destination disk
 *****************************************************************/
 
 	log = log_open (log_name, access, comment, SCCS_ID, np, p);
-	status = setup_disk (src_drive, "Source disk", log, p, ask_for_partitions,
-		 src_px, &src_base, &src_n, &src_disk);
-	status = status || setup_disk (dst_drive, "Destination disk", log, p, ask_for_partitions,
-		 dst_px, &dst_base, &dst_n, &dst_disk);
+	if (all_partitions) src_px = dst_px = 0; /* setup_disk: no selection */
+	status = setup_disk (src_drive, "Source disk", log, p, table, ask_for_partitions,
+		 src_px, src_pt, &src_base, &src_n, &src_disk);
+	status = status || setup_disk (dst_drive, "Destination disk", log, p, table,
+		 ask_for_partitions, dst_px, dst_pt, &dst_base, &dst_n, &dst_disk);
 	if (status) return 1;
 
-/*****************************************************************
-get ready to do the compare
-see which is bigger: src or dst
-*****************************************************************/
-	if (src_n != dst_n) {
-		if ( src_n < dst_n) {
-			common = src_n;
-			big_dst = 1;
-		} else {
-			common = dst_n;
-			big_src = 1;
-		}
-	} else common = src_n;
 	printf ("Source disk fill byte %2X\n", src_fill_char);
 	printf ("Destination disk fill byte %2X\n", dst_fill_char);
 	fprintf (log, "Source disk fill byte %2X\n", src_fill_char);
 	fprintf (log, "Destination disk fill byte %2X\n", dst_fill_char);
-	src_lba = src_base;
-	dst_lba = dst_base;
-	if (boot_track_too) {
-		common += 63;
-		src_lba -= 63;
-		dst_lba -= 63;
-		src_base -= 63;
-		dst_base -= 63;
-		src_n += 63;
-		dst_n += 63;
-	}
-	fprintf (log,"Source base sector %llu Destination base sector %llu\n",
-		src_base,dst_base); 
-/*****************************************************************
-Main compare loop:
-	for each sector in common
-		read src sector
-		read dst sector
-		if match then increment match count
-		else increment different count
-*****************************************************************/
-	for (lba = 0; lba < common; lba++) {
-		feedback (from, 0, lba, big_dst ? dst_n : common); /* give progress feedback to user */
-		is_diff = 0;
-		src_status = read_lba(src_disk, src_lba++, &src_buff);
-		dst_status = read_lba(dst_disk, dst_lba++, &dst_buff);
-		if (src_status || dst_status) {
-			fprintf (log,"read error at sector %llu: src %d dst %d\n", lba, src_status, dst_status);
-			printf ("read error at lba %llu: src %d dst %d\n", lba, src_status, dst_status);
-			return 1;
-		}
-/*****************************************************************
-Compare corresponding sectors
-*****************************************************************/
-
-		for (i = 0; i < BYTES_PER_SECTOR; i++) {
-			if (src_buff[i] != dst_buff[i]) {
-				is_diff = 1;
-				byte_diffs++;
-			}
-		}
-		if (is_diff) {
-			diffs++;
-			add_to_range (d_r,lba);
-			if (log_diffs && (diffs <= 50)) {
-				 fprintf (log,"%12llu ",lba);
-				 if ((diffs%5) == 0) fprintf (log,"\n");
-			}
-		}
-		else {
-			match++;
-		}
-	}
-/*****************************************************************
-Log results for corresponding sectors
-*****************************************************************/
-
-	if  (log_diffs && (diffs)) fprintf (log,"\n");
-	fprintf (log,"Sectors compared: %12llu\n",common);
-	fprintf (log,"Sectors match:    %12llu\n",match);
-	fprintf (log,"Sectors differ:   %12llu\n",diffs);
-	fprintf (log,"Bytes differ:     %12llu\n",byte_diffs);
-	print_range_list(log,"Diffs range: ",d_r);
-	if (big_src) {
-		fprintf (log,"Source (%llu) has %llu more sectors than destination (%llu)\n", src_n, src_n - dst_n, dst_n);
-	}
-/*****************************************************************
-If the destination is larger than the source then
-	look at the remainder of the destination
-*****************************************************************/
-	else if (big_dst) {
-		fprintf (log,"Source (%llu) has %llu fewer sectors than destination (%llu)\n", src_n, dst_n - src_n, dst_n);
-		zero = 0;
-		ofill = sfill = dfill = 0;
-		other = 0;
-		printf ("Destination larger than source; scanning %llu sectors\n", dst_n-common);
-		for (lba = common; lba < dst_n; is_debug?(lba+=100):lba++){
-			feedback (from, 0, lba, dst_n);
-			if((dst_status = read_lba(dst_disk, dst_lba++, &dst_buff))) {
-				fprintf (log,"read error at sector %llu: dst %d\n", lba, dst_status);
-				printf ("read error at lba %llu: dst %d\n", lba, dst_status);
-			}
-			nz = 0;
-			nfill = 0; 
-/*****************************************************************
-classify sector: count zero bytes and fill bytes
-how to count fill bytes? the rule is: all bytes after
-byte [23] are the same. i.e., 488 bytes of the sector are the
-same. We use 480 to give some slack.
-*****************************************************************/
-
-			for (i = 0; i < BYTES_PER_SECTOR; i++) {
-				if ( dst_buff[i] == 0) nz++;
-				else if (dst_buff[i] == dst_buff[BUFF_OFF]) nfill++;
-			}
-			if (nz == BYTES_PER_SECTOR) { zero++; add_to_range(zf_r,lba); }
-			else if (nfill > 480) {
-					if (dst_buff[BUFF_OFF] == src_fill_char) {
-						sfill++;
-						add_to_range(sf_r,lba);
-					} else if (dst_buff[BUFF_OFF] == dst_fill_char) {
-						dfill++;
-						add_to_range(df_r,lba);
-					} else {
-						ofill++;
-						add_to_range(of_r,lba);
-					}
-			}
-			else {
-				other++;
-				add_to_range (o_r,lba);
-			}
-		}
-/*****************************************************************
-log results to log file
-*****************************************************************/
-		if  (log_diffs && (other)) fprintf (log, "\n");
-		fprintf (log,"Zero fill:     %llu\n", zero);
-		fprintf (log,"Src Byte fill (%02X): %llu\n", src_fill_char, sfill);
-		if (src_fill_char == dst_fill_char)
-			fprintf (log, "Dst Fill Byte same as Src Fill Byte\n");
-		else fprintf (log, "Dst Byte fill (%02X): %lu\n", dst_fill_char, dfill);
-		fprintf (log,"Other fill:    %llu\n", ofill);
-		fprintf (log,"Other no fill: %llu\n", other);
-		print_range_list(log,"Zero fill range: ", zf_r);
-		print_range_list(log,"Src fill range: ", sf_r);
-		print_range_list(log,"Dst fill range: ", df_r);
-		print_range_list(log,"Other fill range: ", of_r);
-		print_range_list(log,"Other not filled range: ", o_r);
-	}
+	if (all_partitions)
+		status = cmp_all_parts (src_disk, dst_disk, src_pt, dst_pt,
+			src_fill_char, dst_fill_char, boot_track_too, is_debug,
+			log_diffs, log);
+	else status = cmp_part (src_disk, dst_disk, src_base, src_n, dst_base, dst_n,
+			src_fill_char, dst_fill_char, boot_track_too, is_debug,
+			log_diffs, from, log, &r);
+	if (status) return 1;
 	log_close(log, from);
 	return 0;
 }
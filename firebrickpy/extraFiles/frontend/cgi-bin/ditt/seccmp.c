@@ -45,50 +45,26 @@ If a sector is filled by diskwipe, print the address string
 that starts in the first byte of the sector
 *****************************************************************/
 
-int cmp_sec (	disk_control_ptr src_dcb,	/* source disk */
-		disk_control_ptr dst_dcb,	/* destination disk */
+void log_sec (	unsigned char	*sb,		/* source sector */
+		unsigned char	*db,		/* destination sector */
 		off_t		src_base,	/* base LBA of source address */
 		off_t		src_offset,	/* offset to add to base */
 		off_t		dst_base,	/* ditto for dst */
 		off_t		dst_offset,
 		FILE		*log		/* the log file */
 ) {
-	int		src_status,	/* status of source sector read */
-			dst_status,	/* status of dst sector read */
-			i, j, k,	/* loop indices */
+	int		i, j, k,	/* loop indices */
 			need_separator = 0, /* need to print a separator between byte blocks */
 			print,		/* indicates that a byte pair in the current block differs */
 			n_diff,		/* count of number of bytes not matching */
 			src_fill, dst_fill, zero_fill; /* flags indicating type of fill */
 	off_t		src_lba,dst_lba;/* sector addresses */
-	unsigned char	*sb, *db,	/* sector buffers */
-			src_fill_char,	/* the src fill character, if one exists */
+	unsigned char	src_fill_char,	/* the src fill character, if one exists */
 			dst_fill_char,	/* the dst fill character, if one exists */
 			buff[26];	/* for outputting beginning of sector */
 
-
-/*****************************************************************
-get source and destination sectors and check read status
-*****************************************************************/
 	src_lba = src_base + src_offset;
 	dst_lba = dst_base + dst_offset;
-	src_status = read_lba (src_dcb, src_lba, &sb);
-	dst_status = read_lba (dst_dcb, dst_lba, &db);
-	if (src_status) {
-		fprintf (log,"Src Read error 0x%02X at LBA %llu\n",
-			src_status, src_lba); 
-		printf ("Src Read error 0x%02X at LBA %llu\n",
-			src_status, src_lba);
-	} 
-	if (dst_status) {
-		printf ("Read error on destination\n");
-		fprintf (log,"Dst Read error 0x%02X at LBA %llu\n",
-			dst_status, dst_lba); 
-		printf ("Dst Read error 0x%02X at LBA %llu\n",
-			dst_status, dst_lba);
-	}
-
-	if(src_status || dst_status) return src_status;
 /*****************************************************************
 Compare the source sector to the destination
 *****************************************************************/
@@ -199,6 +175,162 @@ BLOCK MATCH.
 *****************************************************************/
 	printf ("%d bytes different\n",n_diff); 
 	fprintf (log,"%d bytes different\n\n",n_diff);
+}
+
+/*****************************************************************
+Report a read error on one side of a sector pair
+*****************************************************************/
+void log_read_error (FILE *log, char *side, int status, off_t lba)
+{
+	fprintf (log,"%s Read error 0x%02X at LBA %llu\n",
+		side, status, lba);
+	printf ("%s Read error 0x%02X at LBA %llu\n",
+		side, status, lba);
+}
+
+/*****************************************************************
+Read one source sector and one destination sector and compare
+*****************************************************************/
+int cmp_sec (	disk_control_ptr src_dcb,	/* source disk */
+		disk_control_ptr dst_dcb,	/* destination disk */
+		off_t		src_base,	/* base LBA of source address */
+		off_t		src_offset,	/* offset to add to base */
+		off_t		dst_base,	/* ditto for dst */
+		off_t		dst_offset,
+		FILE		*log		/* the log file */
+) {
+	int		src_status,	/* status of source sector read */
+			dst_status;	/* status of dst sector read */
+	off_t		src_lba,dst_lba;/* sector addresses */
+	unsigned char	*sb, *db;	/* sector buffers */
+
+/*****************************************************************
+get source and destination sectors and check read status
+*****************************************************************/
+	src_lba = src_base + src_offset;
+	dst_lba = dst_base + dst_offset;
+	src_status = read_lba (src_dcb, src_lba, &sb);
+	dst_status = read_lba (dst_dcb, dst_lba, &db);
+	if (src_status) log_read_error (log, "Src", src_status, src_lba);
+	if (dst_status) {
+		printf ("Read error on destination\n");
+		log_read_error (log, "Dst", dst_status, dst_lba);
+	}
+
+	if(src_status || dst_status) return src_status;
+	log_sec (sb, db, src_base, src_offset, dst_base, dst_offset, log);
+	return 0;
+}
+
+/*****************************************************************
+Batch mode: compare a list of sector pairs
+The list (one "src_lba dst_lba" pair per line) comes from a file
+or from stdin. The pairs are sorted by source address so both
+disks are read front to back, and pairs that fall close together
+are read with one request per disk (up to SEC_BATCH sectors) rather
+than one request per pair. Each pair is reported just as if it had
+been given with -sector.
+*****************************************************************/
+# define SEC_BATCH 2048 /* sectors per batched read (1 MB) */
+
+typedef struct {off_t src, dst;} sec_pair;
+
+int cmp_pair (const void *a, const void *b)
+{
+	const sec_pair	*x = a, *y = b;
+
+	if (x->src != y->src) return (x->src < y->src)?-1:1;
+	if (x->dst != y->dst) return (x->dst < y->dst)?-1:1;
+	return 0;
+}
+
+int cmp_sec_list (disk_control_ptr src_dcb,	/* source disk */
+		disk_control_ptr dst_dcb,	/* destination disk */
+		FILE		*list,		/* list of sector pairs */
+		FILE		*log)		/* the log file */
+{
+	sec_pair	*pairs = NULL;
+	int		n = 0, /* number of pairs in the list */
+			max = 0, /* allocated size of pairs */
+			first, /* first pair of the current batch */
+			last, /* one past the last pair of the current batch */
+			i,
+			src_status,
+			dst_status,
+			n_err = 0; /* pairs not compared due to read errors */
+	off_t		src_lo, src_n, /* source sectors read for a batch */
+			dst_lo, dst_hi, dst_n, /* destination sectors read for a batch */
+			src_lba, dst_lba;
+	unsigned char	*sb, *db; /* batch buffers */
+
+/*****************************************************************
+Get the list and put it in source disk order
+*****************************************************************/
+	while (2 == fscanf (list, "%llu%llu", &src_lba, &dst_lba)) {
+		if (n == max) {
+			max = max? 2*max: 1024;
+			pairs = (sec_pair *) realloc (pairs, max*sizeof(sec_pair));
+			if (pairs == NULL) {
+				printf ("Unable to allocate memory!\n");
+				return 1;
+			}
+		}
+		pairs[n].src = src_lba;
+		pairs[n].dst = dst_lba;
+		n++;
+	}
+	if (!feof (list)) { /* compare none rather than part of the list */
+		printf ("Sector list is not in \"src dst\" form after %d pairs\n", n);
+		fprintf (log, "Sector list is not in \"src dst\" form after %d pairs, nothing compared\n", n);
+		free (pairs);
+		return 1;
+	}
+	fprintf (log, "Sector list: %d pairs\n", n);
+	printf ("Sector list: %d pairs\n", n);
+	if (n == 0) return 0;
+	qsort (pairs, n, sizeof(sec_pair), cmp_pair);
+
+	sb = (unsigned char *) malloc (SEC_BATCH*BYTES_PER_SECTOR);
+	db = (unsigned char *) malloc (SEC_BATCH*BYTES_PER_SECTOR);
+	if ((sb == NULL) || (db == NULL)) {
+		printf ("Unable to allocate memory!\n");
+		return 1;
+	}
+
+/*****************************************************************
+Gather pairs into batches that fit in SEC_BATCH sectors on both disks
+*****************************************************************/
+	for (first = 0; first < n; first = last) {
+		src_lo = pairs[first].src;
+		dst_lo = dst_hi = pairs[first].dst;
+		for (last = first + 1; last < n; last++) {
+			if (pairs[last].src - src_lo >= SEC_BATCH) break;
+			if (pairs[last].dst < dst_lo) break;
+			if (pairs[last].dst - dst_lo >= SEC_BATCH) break;
+			if (pairs[last].dst > dst_hi) dst_hi = pairs[last].dst;
+		}
+		src_n = pairs[last-1].src - src_lo + 1;
+		dst_n = dst_hi - dst_lo + 1;
+		src_status = read_sectors (src_dcb, src_lo, src_n, sb);
+		dst_status = read_sectors (dst_dcb, dst_lo, dst_n, db);
+		for (i = first; i < last; i++) {
+			if (src_status || dst_status) {
+				/* fall back to one pair at a time to find the bad sector */
+				if (cmp_sec (src_dcb, dst_dcb, pairs[i].src, 0,
+					pairs[i].dst, 0, log)) n_err++;
+				continue;
+			}
+			log_sec (sb + (pairs[i].src - src_lo)*BYTES_PER_SECTOR,
+				db + (pairs[i].dst - dst_lo)*BYTES_PER_SECTOR,
+				pairs[i].src, 0, pairs[i].dst, 0, log);
+		}
+	}
+	fprintf (log, "Sector pairs compared: %d", n - n_err);
+	if (n_err) fprintf (log, " (%d not compared due to read errors)", n_err);
+	fprintf (log, "\n");
+	free (sb);
+	free (db);
+	free (pairs);
 	return 0;
 }
 
@@ -214,6 +346,7 @@ void print_help(char *p)
 	printf ("Usage: %s test-case host operator src-drv src-label dst-drv dst-label [-options]\n",p);
 	printf ("-comment \"...\"\tDescriptive comment\n");
 	printf ("-sector src_lba dst_lba\tSpecify the sectors to compare\n");
+	printf ("-list <file>\tCompare each \"src_lba dst_lba\" pair listed in <file> (- for stdin)\n");
 	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
 	printf ("-log_name <name>\tUse different log file (default is seclog.txt)\n");
 	printf ("-h\tPrint this option list\n");
@@ -235,7 +368,9 @@ main (int np, char **p)
 			dst_offset = 0;
 	int		interactive = 1; /* assume user wants interactive mode unless
 						overriden on command line */
-	FILE		*log;
+	FILE		*log,
+			*list = NULL; /* sector pair list for batch mode */
+	char		list_name[NAME_LENGTH] = "";
 	char		comment [NAME_LENGTH] = "",
 			log_name [NAME_LENGTH] = "seclog.txt",
 			access[2] = "a";
@@ -287,6 +422,15 @@ get command line
 				sscanf (p[i],"%llu",&dst_base);
 				interactive = 0;
 			}
+		} else if (strcmp (p[i],"-list")== 0) {
+			i++;
+			if (i >= np){
+				printf ("%s: -list option requires a file name (or - for stdin)\n",p[0]);
+				help = 1;
+			} else {
+				strncpy (list_name,p[i], NAME_LENGTH - 1);
+				interactive = 0;
+			}
 		} else {
 			printf("Invalid parameter: %s\n", p[i]);
 			help = 1;
@@ -299,6 +443,20 @@ If there is a problem on command line, then print help message
 		print_help(p[0]);
 		return 0;
 	}
+	if (list_name[0]) {
+		if (strcmp (list_name,"-") == 0) {
+			if (strlen (comment) == 0) { /* stdin can't be both comment and list */
+				printf ("%s: -list - requires -comment\n",p[0]);
+				print_help(p[0]);
+				return 0;
+			}
+			list = stdin;
+		}
+		else if ((list = fopen (list_name,"r")) == NULL) {
+			printf ("%s: could not open sector list %s\n",p[0],list_name);
+			return 1;
+		}
+	}
 	time(&from);
 /*****************************************************************
 Open log file; open source and destination
@@ -332,6 +490,12 @@ of zero (or vice versa).
 				dst_base,dst_offset,log);
 			printf ("Enter src (base offset) dst (base offset) (CTRL-D to quit): ");
 		}
+	} else if (list) { /* a list of address pairs */
+		status = cmp_sec_list (src_dcb,dst_dcb,list,log);
+		if (status) {
+			log_close(log,from);
+			return status;
+		}
 	} else { /* one address pair from the command line */
 		status = cmp_sec (src_dcb,dst_dcb,src_base,src_offset,
 			dst_base,dst_offset,log);
@@ -0,0 +1,300 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) sechash.c Linux Version 2.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <sys/utsname.h>
+/*****************************************************************
+Hash ranges of sectors of a disk
+SECHASH hashes any number of sector ranges of a disk in one pass:
+ranges given with -range (or the -first/-last pair of sechash.csh)
+and, with -partitions, every partition in the partition table. The
+ranges are sorted and read lowest sector first in large blocks;
+sectors shared by ranges that overlap are read once (see hash_ranges
+in zhash.c). With no range given the whole disk is hashed.
+
+It replaces sechash.csh, which ran dd once per range, and logs the
+same fields: case, host, user, device, label, comment, the hash, the
+system, the disk, then for each range
+	Hash nnn sectors from first through last
+	HASH  -
+
+program outline
+	get command line
+	open the disk
+	list the ranges
+	hash the ranges
+	log results
+*****************************************************************/
+# define MAX_RANGES	64
+
+static hash_range	r[MAX_RANGES];
+static int		n_ranges = 0;
+
+/*****************************************************************
+Add sectors first through last to the range list
+*****************************************************************/
+int add_range (off_t first, off_t last, char *label)
+{
+	if (n_ranges >= MAX_RANGES) {
+		printf ("More than %d ranges\n",MAX_RANGES);
+		return 1;
+	}
+	r[n_ranges].first = first;
+	r[n_ranges].last = last;
+	strncpy (r[n_ranges].label,label,NAME_LENGTH - 1);
+	n_ranges++;
+	return 0;
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s TestCase Host User Device Label [-options]\n",p);
+	printf ("-before\tName the logfile hashbsec.txt\n");
+	printf ("-after\tName the logfile hashasec.txt\n");
+	printf ("-first <LBA>\tStart hashing at <LBA>\n");
+	printf ("-last <LBA>\tStop hashing at <LBA>\n");
+	printf ("-range <first> <last>\tHash sectors first through last (may be repeated)\n");
+	printf ("-partitions\tHash each partition in the partition table\n");
+	printf ("-comment \" ... \"\tGive a comment on command line\n");
+	printf ("-hash <name>\tmd5sum, sha1sum (default) or sha256sum\n");
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tName the log file <name>\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		drive[NAME_LENGTH] = "/dev/hda", /* default to primary IDE master */
+			hex[2*HASH_MAX_SIZE + 1];
+	int		help = 0,
+			status,
+			i,
+			n_logs = 0,
+			partitions = 0,
+			alg = HASH_SHA1;
+	off_t		first = -1,
+			last = -1,
+			from_lba,
+			to_lba,
+			ns,
+			total,
+			n_read,
+			n_error = 0;
+	disk_control_ptr d;
+	range_ptr	error;
+	progress_ptr	progress;
+	struct utsname	u;
+	static time_t	from;
+	FILE		*log;
+	char		comment[NAME_LENGTH] = "",
+			log_name[NAME_LENGTH] = "none.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 6) {
+		printf ("At least one required parameter is missing\n");
+		help = 1;
+	} else strncpy(drive, p[4], NAME_LENGTH - 1);
+	for (i = 6; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-partitions")== 0) partitions = 1;
+		else if (strcmp (p[i],"-before")== 0) {
+			n_logs++;
+			strcpy (log_name,"hashbsec.txt");
+		}
+		else if (strcmp (p[i],"-after")== 0) {
+			n_logs++;
+			strcpy (log_name,"hashasec.txt");
+		}
+		else if (strcmp (p[i],"-comment")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -comment option requires a comment\n",p[0]);
+				help = 1;
+			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			n_logs++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-hash")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -hash option requires the name of a hash\n",p[0]);
+				help = 1;
+			} else if ((alg = hash_lookup (p[i])) < 0){
+				printf ("%s: unknown hash %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-first")== 0 || strcmp (p[i],"-last")== 0){
+			i++;
+			if (i >= np || sscanf (p[i],"%lld",
+					p[i-1][1] == 'f' ? &first : &last) != 1){
+				printf ("Sector number is missing after either -first or -last option\n");
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-range")== 0){
+			i += 2;
+			if (i >= np || sscanf (p[i-1],"%lld",&from_lba) != 1
+					|| sscanf (p[i],"%lld",&to_lba) != 1){
+				printf ("%s: -range option requires first and last sectors\n",p[0]);
+				help = 1;
+			} else if (from_lba < 0 || to_lba < from_lba) {
+				printf ("%s: invalid range %s %s\n",p[0],p[i-1],p[i]);
+				help = 1;
+			} else if (add_range (from_lba,to_lba,"range")) help = 1;
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (!help && n_logs == 0) {
+		printf ("Must select -before, -after, or -log_name <name>\n");
+		help = 1;
+	}
+	if (n_logs > 1) {
+		printf ("Too many log files specified\n");
+		help = 1;
+	}
+	if (help) {
+		print_help(p[0]);
+		return 1;
+	}
+
+	d = open_disk (drive,&status);
+	if (status){
+		printf ("%s could not access drive %s status code %d\n",
+			p[0],drive,status);
+		return 1;
+	}
+	ns = n_sectors(d);
+	if (first >= 0 || last >= 0 || (n_ranges == 0 && !partitions)) {
+		if (first < 0) first = 0;
+		if (last < 0) last = ns - 1;
+		if (last < first) {
+			printf ("Last sector (%lld) is before first sector (%lld)\n",last,first);
+			return 1;
+		}
+		add_range (first,last,"sectors");
+	}
+	if (partitions && hash_partition_ranges (d,r,&n_ranges,MAX_RANGES)) {
+		printf ("%s: could not read the partition table of %s (or more than %d ranges)\n",
+			p[0],drive,MAX_RANGES);
+		return 1;
+	}
+	for (i = 0; i < n_ranges; i++)
+		if (r[i].last >= ns) {
+			printf ("Last sector (%lld) is after end of drive (%lld)\n",
+				r[i].last,ns);
+			return 1;
+		}
+
+	if (strlen(comment) == 0) {
+		printf ("Please enter a descriptive comment\n");
+		fgets(comment, NAME_LENGTH, stdin);
+		comment[strcspn (comment,"\n")] = '\0';
+	}
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = fopen (log_name,access);
+	if (log == NULL){
+		log = stdout;
+		printf("open of log file unsuccessful...using stdout instead\n");
+	}
+	fprintf (log,"%s compiled on %s at %s\n",SCCS_ID[0],SCCS_ID[1],SCCS_ID[2]);
+	fprintf (log,"CMD:");
+	for (i = 0; i < np; i++) fprintf (log," %s",p[i]);
+	fprintf (log,"\n");
+	fprintf (log,"Case: %s\n",p[1]);
+	fprintf (log,"Host: %s\n",p[2]);
+	fprintf (log,"User: %s\n",p[3]);
+	fprintf (log,"Device: %s\n",drive);
+	fprintf (log,"Label: %s\n",p[5]);
+	fprintf (log,"Comment: %s\n",comment);
+	fprintf (log,"Hash: %s\n",hash_name(alg));
+	if (uname (&u) == 0)
+		fprintf (log,"%s %s %s %s %s\n",u.sysname,u.nodename,u.release,
+			u.version,u.machine);
+	fprintf (log,"%s\n",ZH_H_ID);
+	fprintf (log,"Hash kernels: %s\n",hash_kernels());
+	log_disk(log,"Hash",d);
+
+	printf ("run start %s",ctime(&from));
+	error = create_range_list();
+	total = hash_sort_ranges (r,n_ranges);
+	fprintf (log,"%d ranges, %llu sectors to read\n",n_ranges,total);
+	progress = progress_start ("",0,total);
+	status = hash_ranges (d,r,n_ranges,1 << alg,error,&n_read,progress);
+	progress_end (progress);
+	if (status) {
+		printf ("%s: not enough memory or threads to hash %s\n",p[0],drive);
+		fprintf (log,"%s: not enough memory or threads to hash %s\n",p[0],drive);
+		return 1;
+	}
+
+	for (i = 0; i < n_ranges; i++) {
+		fprintf (log,"Hash %llu sectors from %llu through %llu (%s)\n",
+			r[i].last - r[i].first + 1,r[i].first,r[i].last,r[i].label);
+		if (r[i].n_error) {
+			fprintf (log,"%llu sectors could not be read (hashed as zero)\n",
+				r[i].n_error);
+			n_error += r[i].n_error;
+		}
+		fprintf (log,"%s  -\n",hash_hex (r[i].digest[alg],hash_size(alg),hex));
+		printf ("%s  - %llu-%llu %s\n",hex,r[i].first,r[i].last,r[i].label);
+	}
+	if (n_error) print_range_list (log,"Read error range: ",error);
+	log_close (log,from);
+	fprintf (log," \n \n");
+	return n_error ? 1 : 0;
+}
@@ -0,0 +1,536 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) splitver.c Linux Version 1.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <fcntl.h>
+# include <glob.h>
+# include <ctype.h>
+# include <pthread.h>
+# include <sys/stat.h>
+/*****************************************************************
+Verify a dcfldd split image against its hash log
+SPLITVER checks the segments image.000, image.001, ... written by
+dcfldd split=... against the hashlog dcfldd wrote with them. It
+replaces the cat | md5sum pipe of dcflddEvidenceVerify.sh, which read
+the segments one after another and whose test could never fail.
+
+A pool of threads (-threads) reads the segments, each thread taking
+the next segment not yet taken, and passes the data in order to the
+main thread for the digest of the whole image, which is compared with
+the Total line of the hashlog. If the hashlog also has a digest for
+each segment (dcfldd hashwindow= set to the split size) each thread
+hashes its segment as it reads it, so a bad segment is named rather
+than just the image failing. Reads go through a pool of
+2*threads + 1 buffers of SPLIT_CHUNK bytes, so memory does not grow
+with the segment size.
+
+Exit status is 0 if the image matches, 1 if not (or it can not be
+read).
+
+program outline
+	get command line
+	read the hashlog, list the segments
+	read and hash the segments with a pool of threads
+	log segments that differ and the verdict
+*****************************************************************/
+# define SPLIT_THREADS	4	/* default number of threads */
+# define SPLIT_MAX_THREADS 16
+# define SPLIT_CHUNK	(1024*1024) /* bytes per read */
+# define SPLIT_MAX_WINDOWS 65536
+
+# define SEG_SAME	0
+# define SEG_DIFFERS	1
+# define SEG_UNREAD	2	/* could not be read */
+# define SEG_UNCHECKED	3	/* no digest in the hashlog */
+
+typedef struct { /* one segment file */
+	char		*name;
+	off_t		offset,	/* of its first byte in the image */
+			size;
+	int		status,	/* SEG_xxx */
+			window;	/* its digest in the hashlog, or -1 */
+	unsigned char	digest[HASH_MAX_SIZE];
+} segment;
+
+typedef struct { /* one read buffer */
+	unsigned char	*buf;
+	int		seg;	/* segment it holds data of, -1 if free */
+	long		seq;	/* which chunk of the segment */
+	size_t		n;	/* bytes in it; under SPLIT_CHUNK ends the segment */
+} chunk;
+
+typedef struct {
+	segment		*s;
+	int		n_segs,
+			alg,
+			check;	/* hash each segment too */
+	volatile int	next,	/* next segment to take */
+			at;	/* segment the image digest is at */
+	chunk		*c;
+	int		n_chunks,
+			n_free;
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+} split_job;
+
+typedef struct { /* a window digest from the hashlog */
+	off_t		from,
+			to;
+	char		hex[2*HASH_MAX_SIZE + 1];
+} window;
+
+static window	w[SPLIT_MAX_WINDOWS];
+static int	n_windows = 0;
+
+/*****************************************************************
+Take a free buffer for segment i. The last free buffer is kept for
+the segment the image digest is waiting on, so the other threads can
+not take every buffer while it starves.
+*****************************************************************/
+chunk *get_chunk (split_job *j, int i)
+{
+	int	k;
+
+	pthread_mutex_lock (&j->lock);
+	while (j->n_free == 0 || (i != j->at && j->n_free < 2))
+		pthread_cond_wait (&j->wake,&j->lock);
+	for (k = 0; j->c[k].seg != -1; k++);
+	j->c[k].seg = i;
+	j->c[k].n = (size_t) -1; /* not filled yet */
+	j->n_free--;
+	pthread_mutex_unlock (&j->lock);
+	return j->c + k;
+}
+
+/*****************************************************************
+Read up to n bytes; returns the count, or -1 on a read error
+*****************************************************************/
+ssize_t read_full (int fd, unsigned char *b, size_t n)
+{
+	ssize_t	k;
+	size_t	done = 0;
+
+	while (done < n) {
+		k = read (fd,b + done,n - done);
+		if (k < 0) return -1;
+		if (k == 0) break;
+		done += k;
+	}
+	return done;
+}
+
+/*****************************************************************
+Thread body: read (and hash) segments until none are left
+*****************************************************************/
+void *seg_thread (void *arg)
+{
+	split_job	*j = (split_job *) arg;
+	segment		*s;
+	chunk		*c;
+	hash_ctx	h;
+	ssize_t		n;
+	long		seq;
+	int		i,
+			fd;
+
+	while ((i = __sync_fetch_and_add (&j->next,1)) < j->n_segs) {
+		s = j->s + i;
+		fd = open (s->name,O_RDONLY);
+		if (fd < 0) s->status = SEG_UNREAD;
+		else posix_fadvise (fd,0,0,POSIX_FADV_SEQUENTIAL);
+		if (j->check) hash_init (&h,j->alg);
+		for (seq = 0; ; seq++) {
+			c = get_chunk (j,i);
+			n = fd < 0 ? 0 : read_full (fd,c->buf,SPLIT_CHUNK);
+			if (n < 0) {
+				s->status = SEG_UNREAD;
+				n = 0;
+			}
+			if (j->check) hash_update (&h,c->buf,n);
+			pthread_mutex_lock (&j->lock);
+			c->seq = seq;
+			c->n = n;
+			pthread_cond_broadcast (&j->wake);
+			pthread_mutex_unlock (&j->lock);
+			if (n < SPLIT_CHUNK) break;
+		}
+		if (fd >= 0) close (fd);
+		if (j->check) hash_final (&h,s->digest);
+	}
+	return NULL;
+}
+
+/*****************************************************************
+Read a dcfldd hashlog: window lines "<from> - <to>: <hex>" (perhaps
+after the name of the hash) go in w, the digest on the Total line (or
+failing that the last digest in the file) in total
+	returns 0, or 1 if no digest was found
+*****************************************************************/
+int read_hashlog (FILE *f, int size, char *total)
+{
+	char		line[256],
+			copy[256],
+			*t,
+			*last,
+			colon;
+	unsigned long long from,
+			to;
+	int		got_total = 0;
+
+	total[0] = '\0';
+	while (fgets (line,sizeof(line),f)) {
+		strcpy (copy,line);
+		last = NULL;
+		for (t = strtok (copy," \t\r\n:()"); t; t = strtok (NULL," \t\r\n:()"))
+			if (strlen(t) == 2*size && strspn (t,"0123456789abcdefABCDEF") == 2*size)
+				last = t;
+		if (last == NULL) continue;
+		if (strncmp (line,"Total",5) == 0) {
+			strcpy (total,last);
+			got_total = 1;
+			continue;
+		}
+		if (!got_total) strcpy (total,last);
+		for (t = line; *t && !(isdigit(*t) && (t == line || isspace(t[-1]))); t++);
+		if (n_windows < SPLIT_MAX_WINDOWS
+				&& sscanf (t,"%llu - %llu%c",&from,&to,&colon) == 3
+				&& colon == ':' && to > from) {
+			w[n_windows].from = from;
+			w[n_windows].to = to;
+			strcpy (w[n_windows].hex,last);
+			n_windows++;
+		}
+	}
+	return total[0] == '\0';
+}
+
+/*****************************************************************
+Find the window digest of segment s (its window starts at the same
+byte and is as long, counting the end byte either way dcfldd may
+write it; the last window may be written full length)
+*****************************************************************/
+int find_window (segment *s, int last)
+{
+	int	i;
+	off_t	n;
+
+	for (i = 0; i < n_windows; i++) {
+		if (w[i].from != s->offset) continue;
+		n = w[i].to - w[i].from;
+		if (n == s->size || n + 1 == s->size || (last && n >= s->size))
+			return i;
+	}
+	return -1;
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s image hashlog [-options]\n",p);
+	printf ("\timage is the dcfldd of= name: the segments are image.*\n");
+	printf ("\thashlog is the dcfldd hashlog= file\n");
+	printf ("-hash <name>\tdcfldd hash=: md5sum (default), sha1sum or sha256sum\n");
+	printf ("-total <hex>\tCheck against <hex> instead of the Total in the hashlog\n");
+	printf ("-threads nnn\tRead nnn segments at a time (default %d)\n",SPLIT_THREADS);
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tName the log file <name> (default splitverlog.txt)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		pattern[NAME_LENGTH],
+			total[2*HASH_MAX_SIZE + 1] = "",
+			want[2*HASH_MAX_SIZE + 1] = "",
+			hex[2*HASH_MAX_SIZE + 1];
+	int		help = 0,
+			i,
+			k,
+			alg = HASH_MD5,
+			n_threads = SPLIT_THREADS,
+			n_started = 0,
+			n_bad = 0,
+			n_checked = 0,
+			n_names = 0;
+	long		seq;
+	size_t		n;
+	off_t		offset = 0;
+	split_job	j;
+	segment		*s;
+	chunk		*c;
+	hash_ctx	h;
+	unsigned char	digest[HASH_MAX_SIZE];
+	pthread_t	tid[SPLIT_MAX_THREADS];
+	glob_t		g;
+	char		**names, /* the segments: image.<digits> only */
+			*suffix;
+	struct stat	st;
+	static time_t	from;
+	FILE		*log,
+			*f;
+	char		log_name[NAME_LENGTH] = "splitverlog.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 3) help = 1;
+	for (i = 3; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-total")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -total option requires a digest\n",p[0]);
+				help = 1;
+			} else strncpy(want, p[i], 2*HASH_MAX_SIZE);
+		}
+		else if (strcmp (p[i],"-hash")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -hash option requires the name of a hash\n",p[0]);
+				help = 1;
+			} else if ((alg = hash_lookup (p[i])) < 0){
+				printf ("%s: unknown hash %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-threads")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -threads option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&n_threads) != 1
+					|| n_threads < 1 || n_threads > SPLIT_MAX_THREADS){
+				printf ("%s: -threads must be 1 to %d\n",p[0],SPLIT_MAX_THREADS);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (help) {
+		print_help(p[0]);
+		return 1;
+	}
+	if (want[0] && strlen(want) != 2*hash_size(alg)) {
+		printf ("%s: -total %s is not a %s digest\n",p[0],want,hash_name(alg));
+		return 1;
+	}
+
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = fopen (log_name,access);
+	if (log == NULL){
+		log = stdout;
+		printf("open of log file unsuccessful...using stdout instead\n");
+	}
+	fprintf (log,"%s compiled on %s at %s\n",SCCS_ID[0],SCCS_ID[1],SCCS_ID[2]);
+	fprintf (log,"CMD:");
+	for (i = 0; i < np; i++) fprintf (log," %s",p[i]);
+	fprintf (log,"\n");
+	fprintf (log,"Image: %s\n",p[1]);
+	fprintf (log,"Hashlog: %s\n",p[2]);
+	fprintf (log,"Hash: %s\n",hash_name(alg));
+	fprintf (log,"%s\n",ZH_H_ID);
+	fprintf (log,"Hash kernels: %s\n",hash_kernels());
+
+	f = fopen (p[2],"r");
+	if (f == NULL && !want[0]) {
+		printf ("%s: could not open hashlog %s\n",p[0],p[2]);
+		fprintf (log,"Could not open hashlog %s\n",p[2]);
+		log_close (log,from);
+		return 1;
+	}
+	if (f) {
+		if (read_hashlog (f,hash_size(alg),total) && !want[0]) {
+			printf ("%s: no %s digest in hashlog %s\n",p[0],hash_name(alg),p[2]);
+			fprintf (log,"No %s digest in hashlog %s\n",hash_name(alg),p[2]);
+			log_close (log,from);
+			return 1;
+		}
+		fclose (f);
+	}
+	if (want[0]) strcpy (total,want);
+
+	snprintf (pattern,NAME_LENGTH,"%s.*",p[1]);
+	if (glob (pattern,0,NULL,&g) == 0) {
+		/* image.log, image.md5 and the like are not segments */
+		names = (char **) calloc (g.gl_pathc,sizeof(char *));
+		if (names == NULL) {
+			printf ("Unable to allocate memory!\n");
+			return 1;
+		}
+		for (i = 0; i < g.gl_pathc; i++) {
+			suffix = g.gl_pathv[i] + strlen (p[1]) + 1;
+			if (*suffix && strspn (suffix,"0123456789") == strlen (suffix))
+				names[n_names++] = g.gl_pathv[i];
+		}
+	}
+	if (n_names == 0) {
+		printf ("%s: no segments %s\n",p[0],pattern);
+		fprintf (log,"No segments %s\n",pattern);
+		log_close (log,from);
+		return 1;
+	}
+	memset (&j,0,sizeof(j));
+	j.n_segs = n_names;
+	j.alg = alg;
+	j.s = (segment *) calloc (j.n_segs,sizeof(segment));
+	j.n_chunks = j.n_free = 2*n_threads + 1;
+	j.c = (chunk *) calloc (j.n_chunks,sizeof(chunk));
+	if (j.s == NULL || j.c == NULL) {
+		printf ("Unable to allocate memory!\n");
+		return 1;
+	}
+	for (i = 0; i < j.n_chunks; i++) {
+		j.c[i].seg = -1;
+		if (posix_memalign ((void **) &j.c[i].buf,4096,SPLIT_CHUNK)) {
+			printf ("Unable to allocate memory!\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < j.n_segs; i++) {
+		s = j.s + i;
+		s->name = names[i];
+		s->offset = offset;
+		if (stat (s->name,&st) == 0) s->size = st.st_size;
+		offset += s->size;
+	}
+	for (i = 0; i < j.n_segs; i++) {
+		s = j.s + i;
+		s->window = find_window (s,i == j.n_segs - 1);
+		if (s->window >= 0) j.check = 1;
+		else s->status = SEG_UNCHECKED;
+	}
+	fprintf (log,"%d segments, %llu bytes, %d segment digests in the hashlog\n",
+		j.n_segs,offset,n_windows);
+	fprintf (log,"%d threads\n",n_threads);
+
+	printf ("run start %s",ctime(&from));
+	pthread_mutex_init (&j.lock,NULL);
+	pthread_cond_init (&j.wake,NULL);
+	for (i = 0; i < n_threads; i++)
+		if (pthread_create (&tid[n_started],NULL,seg_thread,&j) == 0) n_started++;
+	if (!n_started) {
+		printf ("%s: could not start any threads\n",p[0]);
+		fprintf (log,"Could not start any threads\n");
+		log_close (log,from);
+		return 1;
+	}
+
+	/* the image digest, taking each segment's chunks in order */
+	hash_init (&h,alg);
+	for (i = 0; i < j.n_segs; i++) {
+		for (seq = 0; ; seq++) {
+			pthread_mutex_lock (&j.lock);
+			for (;;) {
+				for (k = 0; k < j.n_chunks; k++)
+					if (j.c[k].seg == i && j.c[k].seq == seq && j.c[k].n != (size_t) -1)
+						break;
+				if (k < j.n_chunks) break;
+				pthread_cond_wait (&j.wake,&j.lock);
+			}
+			c = j.c + k;
+			n = c->n; /* c may be taken again once it is free */
+			pthread_mutex_unlock (&j.lock);
+			hash_update (&h,c->buf,n);
+			pthread_mutex_lock (&j.lock);
+			if (n < SPLIT_CHUNK) j.at = i + 1;
+			c->seg = -1;
+			j.n_free++;
+			pthread_cond_broadcast (&j.wake);
+			pthread_mutex_unlock (&j.lock);
+			if (n < SPLIT_CHUNK) break;
+		}
+	}
+	hash_final (&h,digest);
+	for (i = 0; i < n_started; i++) pthread_join (tid[i],NULL);
+
+	for (i = 0; i < j.n_segs; i++) {
+		s = j.s + i;
+		if (s->status == SEG_UNREAD) {
+			n_bad++;
+			printf ("Segment %d (%s) could not be read\n",i,s->name);
+			fprintf (log,"Segment %d (%s) could not be read\n",i,s->name);
+		}
+		if (s->status != SEG_SAME) continue;
+		n_checked++;
+		hash_hex (s->digest,hash_size(alg),hex);
+		if (strcasecmp (hex,w[s->window].hex)) {
+			s->status = SEG_DIFFERS;
+			n_bad++;
+			printf ("Segment %d (%s) differs\n",i,s->name);
+			fprintf (log,"Segment %d (%s) bytes %llu through %llu differs: %s %s, hashlog %s\n",
+				i,s->name,s->offset,s->offset + s->size - 1,hash_name(alg),
+				hex,w[s->window].hex);
+		}
+	}
+	if (j.check)
+		fprintf (log,"%d of %d segments checked against the hashlog, %d bad\n",
+			n_checked,j.n_segs,n_bad);
+	if (n_windows > j.n_segs) { /* dcfldd hashed more than is here */
+		n_bad++;
+		printf ("Segments missing: %d in the hashlog, %d found\n",n_windows,j.n_segs);
+		fprintf (log,"Segments missing: %d in the hashlog, %d found\n",n_windows,j.n_segs);
+	}
+	hash_hex (digest,hash_size(alg),hex);
+	if (strcasecmp (hex,total)) n_bad++;
+	fprintf (log,"Total %s %s %s (hashlog %s)\n",hash_name(alg),hex,
+		strcasecmp (hex,total) ? "differs" : "matches",total);
+	if (n_bad && !j.check)
+		fprintf (log,"No segment digests in the hashlog to tell which segment is bad\n");
+	printf ("%s\n",n_bad ? "Image does NOT match the hashlog" : "Image matches the hashlog");
+	fprintf (log,"%s\n",n_bad ? "Image does NOT match the hashlog" : "Image matches the hashlog");
+	log_close (log,from);
+	fprintf (log," \n \n");
+	return n_bad ? 1 : 0;
+}
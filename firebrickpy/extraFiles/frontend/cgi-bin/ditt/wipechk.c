@@ -0,0 +1,291 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) wipechk.c Linux Version 1.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <fcntl.h>
+/*****************************************************************
+Check that a disk is in DISKWIPE format
+WIPECHK reads a whole disk and checks that every sector is as
+DISKWIPE would have written it: the sector's own C/H/S and LBA
+address at the start (see diskwipe.c) followed by the fill byte.
+No reference disk is needed; the expected contents of each sector
+are made by the same pattern generator that DISKWIPE uses.
+
+Sectors that are not in pattern are logged as ranges, in three
+categories:
+	misplaced header: a DISKWIPE header, but for another sector
+	bad header: the sector does not start with a DISKWIPE header
+	fill: the header is right but the fill is not
+
+program outline
+	get command line
+	open the disk
+	for each block of CHK_BLOCK sectors
+		make the expected block
+		read the block
+		if they differ, sort out each sector that differs
+	log results
+*****************************************************************/
+# define CHK_BLOCK	8192	/* sectors per read (4 MB) */
+
+typedef struct {
+	off_t		n_misplaced, /* sectors in each category */
+			n_bad_header,
+			n_bad_fill,
+			n_error; /* sectors that could not be read */
+	range_ptr	misplaced, /* ... and where they are */
+			bad_header,
+			bad_fill,
+			error;
+} chk_result;
+
+/*****************************************************************
+Sort out why a sector (lba) is not as expected (expect) and add it
+to the matching range list
+*****************************************************************/
+void classify (chk_result *r, off_t lba, unsigned char *buf, unsigned char *expect)
+{
+	int		hlen = strlen ((char *) expect) + 1; /* header and its NULL */
+	unsigned long long c, h, s, l;
+	char		hdr[48]; /* the sector's header, parsed from a copy */
+	int		parsed = 0;
+
+	if (hlen > sizeof(hdr)) hlen = sizeof(hdr);
+	if (memcmp (buf, expect, hlen)) {
+		/* the sector holds no NULL of its own and may be digits to the
+		   end, so only a header ended within hlen is parsed, from hdr */
+		if (memchr (buf, 0, hlen)) {
+			memcpy (hdr, buf, hlen);
+			parsed = sscanf (hdr, "%llu/%llu/%llu %llu", &c, &h, &s, &l) == 4;
+		}
+		if (parsed) {
+			r->n_misplaced++;
+			add_to_range (r->misplaced, lba);
+		} else {
+			r->n_bad_header++;
+			add_to_range (r->bad_header, lba);
+		}
+	} else {
+		r->n_bad_fill++;
+		add_to_range (r->bad_fill, lba);
+	}
+}
+
+/*****************************************************************
+Check every sector of disk d against the DISKWIPE pattern
+	heads is the head count the pattern was written with
+	fill is the fill byte
+	r gets the results
+	returns 0 if the whole disk was read
+*****************************************************************/
+int check_disk (disk_control_ptr d, off_t heads, unsigned char fill,
+	time_t start, chk_result *r)
+{
+	wipe_pattern	w;
+	unsigned char	*buf,
+			*expect;
+	off_t		s,
+			k,
+			j,
+			n_sect = n_sectors(d);
+	int		status = 0;
+	progress_ptr	progress;
+
+	if (posix_memalign ((void **) &buf, 4096, CHK_BLOCK*BYTES_PER_SECTOR)
+		|| posix_memalign ((void **) &expect, 4096, CHK_BLOCK*BYTES_PER_SECTOR)) {
+		printf ("Unable to allocate memory!\n");
+		return 1;
+	}
+	/* the read ahead overlaps the next read with checking this block */
+	posix_fadvise (d->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	printf ("Check from %llu up to %llu\n",(off_t) 0,n_sect);
+	wipe_pattern_init (&w, 0, heads, fill);
+	progress = progress_start ("", 0, n_sect);
+	for (s = 0; s < n_sect; s += k) {
+		k = CHK_BLOCK;
+		if (s + k > n_sect) k = n_sect - s;
+		wipe_pattern_fill (&w, expect, k);
+		if (read_sectors (d, s, k, buf)) {
+			/* take it a sector at a time to find the bad ones */
+			for (j = 0; j < k; j++)
+				if (read_sectors (d, s + j, 1, buf + j*BYTES_PER_SECTOR)) {
+					r->n_error++;
+					add_to_range (r->error, s + j);
+					memcpy (buf + j*BYTES_PER_SECTOR,
+						expect + j*BYTES_PER_SECTOR, BYTES_PER_SECTOR);
+				}
+			status = 1;
+		}
+		if (memcmp (buf, expect, k*BYTES_PER_SECTOR))
+			for (j = 0; j < k; j++)
+				if (memcmp (buf + j*BYTES_PER_SECTOR,
+						expect + j*BYTES_PER_SECTOR, BYTES_PER_SECTOR))
+					classify (r, s + j, buf + j*BYTES_PER_SECTOR,
+						expect + j*BYTES_PER_SECTOR);
+		progress_add (progress, k);
+	}
+	progress_end (progress);
+	free (buf);
+	free (expect);
+	return status;
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s test-case host operator drive fill [-options]\n",p);
+	printf ("-heads nnn\tThe pattern was written with nnn heads (diskwipe -heads)\n");
+	printf ("-comment \" ... \"\tGive a comment on command line\n");
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tUse a different log file (default is wipechklog.txt)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		drive[NAME_LENGTH] = "/dev/hda"; /* default to primary IDE master */
+	int		help = 0,
+			ifill,
+			status,
+			i,
+			hd = 0;
+	off_t		ns,
+			n_out;
+	disk_control_ptr d;
+	chk_result	r;
+	static time_t	from;
+	FILE		*log;
+	char		comment[NAME_LENGTH] = "",
+			log_name[NAME_LENGTH] = "wipechklog.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 6) help = 1;
+	else strncpy(drive, p[4], NAME_LENGTH - 1);
+	for (i = 6; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-comment")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -comment option requires a comment\n",p[0]);
+				help = 1;
+			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-heads")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -heads option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&hd) != 1 || hd <= 0){
+				printf ("%s: invalid -heads value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (help) {
+		print_help(p[0]);
+		return 0;
+	}
+	if (sscanf (p[5],"%2x",&ifill) != 1) { /* first two characters are HEX */
+		printf ("%s: fill value (%s) is not valid\n",p[0],p[5]);
+		return 1;
+	}
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = log_open(log_name,access,comment,SCCS_ID,np,p);
+
+	d = open_disk (drive,&status);
+	if (status){
+		printf ("%s could not access drive %s status code %d\n",
+			p[0],drive,status);
+		fprintf (log,"%s could not access drive %s status code %d\n",
+			p[0],drive,status);
+		return 1;
+	}
+	log_disk(log,"Check",d);
+	if (!hd) hd = n_heads(d);
+	if (!hd) {
+		printf ("%s: no head count for %s, use -heads\n",p[0],drive);
+		return 1;
+	}
+	fprintf (log,"Pattern fill %02X heads %d\n",ifill,hd);
+
+	memset (&r, 0, sizeof(r));
+	r.misplaced = create_range_list();
+	r.bad_header = create_range_list();
+	r.bad_fill = create_range_list();
+	r.error = create_range_list();
+	ns = n_sectors(d);
+	check_disk (d, (off_t) hd, (unsigned char) ifill, from, &r);
+
+	n_out = r.n_misplaced + r.n_bad_header + r.n_bad_fill + r.n_error;
+	fprintf (log,"%llu sectors checked\n",ns);
+	fprintf (log,"%llu sectors in pattern\n",ns - n_out);
+	fprintf (log,"%llu sectors with a misplaced header\n",r.n_misplaced);
+	fprintf (log,"%llu sectors with no DISKWIPE header\n",r.n_bad_header);
+	fprintf (log,"%llu sectors with a different fill\n",r.n_bad_fill);
+	if (r.n_error) fprintf (log,"%llu sectors could not be read\n",r.n_error);
+	if (r.n_misplaced) print_range_list (log,"Misplaced header range: ",r.misplaced);
+	if (r.n_bad_header) print_range_list (log,"No header range: ",r.bad_header);
+	if (r.n_bad_fill) print_range_list (log,"Fill differs range: ",r.bad_fill);
+	if (r.n_error) print_range_list (log,"Read error range: ",r.error);
+	fprintf (log,"%s %s in DISKWIPE pattern with %02X\n",drive,
+		n_out ? "is NOT" : "is",ifill);
+	printf ("%llu of %llu sectors in pattern: %s %s in DISKWIPE pattern with %02X\n",
+		ns - n_out,ns,drive,n_out ? "is NOT" : "is",ifill);
+	log_close (log,from);
+	return n_out ? 1 : 0;
+}
@@ -45,6 +45,11 @@ redistribution.
 # include <sys/ioctl.h>
 # include <scsi/scsi.h>
 # include <scsi/scsi_ioctl.h>
+# include <sys/time.h>
+# include <pthread.h>
+# ifndef BLKZEROOUT
+# define BLKZEROOUT _IO(0x12,127) /* older kernel headers lack it */
+# endif
 
 char *SCCS_Z = "@(#) zbios.c Linux Version 1.5 Created 03/21/05 at 09:09:12 "\
 "\nsupport lib compiled "__DATE__" at "__TIME__"\n"Z_H_ID;
@@ -55,7 +60,7 @@ char *SCCS_Z = "@(#) zbios.c Linux Version 1.5 Created 03/21/05 at 09:09:12 "\
 Support Library
 	Probe an IDE or SCSI disk for Mfg & Serial #
 Log file: open, log disk, close
-	Give user progress and completion time feedback
+	Progress of long loops: counter and ticker thread
 	Disk utilities: open, read, write, convert LBA <=> C/H/S
 	Partition table: get and print
 *****************************************************************/
@@ -226,6 +231,90 @@ int probe_serial_model (disk_control_ptr d)
 	return 0;
 }
 
+/*****************************************************************
+DISKWIPE pattern generator
+	wipe_pattern_init -- start the pattern at sector lba for a disk
+		with heads heads per cylinder and fill byte fill
+	wipe_pattern_fill -- put the pattern for the next n sectors in buf
+The sector image is the same as
+	memset (sector, fill, BYTES_PER_SECTOR);
+	sprintf (sector, "%05llu/%03llu/%02llu %012llu", c, h, s, lba);
+but only the first sector is formatted with sprintf; after that the
+digits of the address string are stepped in place. sprintf is used
+again only when a field runs out of digits (e.g., cylinder 99999 to
+100000), so the string grows exactly as sprintf would make it.
+*****************************************************************/
+
+/* format the whole address string and note where the fields end */
+static void wipe_pattern_format (wipe_pattern_ptr w)
+{
+	w->len = sprintf (w->hdr, "%05llu/%03llu/%02llu %012llu",
+		w->cylinder, w->head, w->sector, w->lba);
+	w->c_end = strchr (w->hdr, '/') - w->hdr - 1;
+	w->h_end = strchr (w->hdr + w->c_end + 2, '/') - w->hdr - 1;
+	w->s_end = strchr (w->hdr, ' ') - w->hdr - 1;
+}
+
+/* add one to the digits hdr[first..last]; return 1 if the field overflows */
+static int wipe_pattern_bump (char *hdr, int first, int last)
+{
+	for (; last >= first; last--) {
+		if (hdr[last] != '9') {
+			hdr[last]++;
+			return 0;
+		}
+		hdr[last] = '0';
+	}
+	return 1;
+}
+
+void wipe_pattern_init (wipe_pattern_ptr w, off_t lba, off_t heads,
+	unsigned char fill)
+{
+	off_t	track = lba/DISK_MAX_SECTORS;
+
+	w->lba = lba;
+	w->heads = heads;
+	w->fill = fill;
+	w->sector = lba%DISK_MAX_SECTORS + 1;
+	w->head = track%heads;
+	w->cylinder = track/heads;
+	wipe_pattern_format (w);
+}
+
+void wipe_pattern_fill (wipe_pattern_ptr w, unsigned char *buf, off_t n)
+{
+	int	redo; /* a field overflowed: format the string again */
+
+	for (; n > 0; n--, buf += BYTES_PER_SECTOR) {
+		memcpy (buf, w->hdr, w->len + 1);
+		memset (buf + w->len + 1, w->fill, BYTES_PER_SECTOR - w->len - 1);
+
+		/* step to the next sector */
+		w->lba++;
+		redo = wipe_pattern_bump (w->hdr, w->s_end + 2, w->len - 1);
+		if (w->sector < DISK_MAX_SECTORS) {
+			w->sector++;
+			redo |= wipe_pattern_bump (w->hdr, w->h_end + 2, w->s_end);
+			if (redo) wipe_pattern_format (w);
+			continue;
+		}
+		w->sector = 1;
+		w->hdr[w->s_end - 1] = '0';
+		w->hdr[w->s_end] = '1';
+		if (++w->head < w->heads)
+			redo |= wipe_pattern_bump (w->hdr, w->c_end + 2, w->h_end);
+		else {
+			w->head = 0;
+			w->cylinder++;
+			if (w->h_end - w->c_end - 1 != 3) redo = 1; /* head was wider than %03 */
+			else memset (w->hdr + w->c_end + 2, '0', 3);
+			redo |= wipe_pattern_bump (w->hdr, 0, w->c_end);
+		}
+		if (redo) wipe_pattern_format (w);
+	}
+}
+
 /*****************************************************************
 Create an empty list of ranges
 *****************************************************************/
@@ -341,6 +430,177 @@ FILE * log_open(char *name, char *access, char *comment, char **stats,
 	return log;
 }
 
+/*****************************************************************
+I/O statistics (see io_stats in zbios.h)
+Each read, write or zero out request is timed and counted in the
+disk's io_stats with atomic adds, so the threads of a program can
+share a disk. log_disk notes which disks go to which log, and
+log_close appends a section for each of them to that log:
+	==== I/O statistics <drive>
+	a line per kind of request: count, bytes, retries, errors,
+		p50, p99 and max request time (microseconds), and MB/s
+		while a request was in progress
+	time waiting for I/O against wall clock time since the open;
+		the rest is time spent computing (or in other I/O).
+		Requests from several threads overlap, so I/O wait can
+		be more than wall time.
+*****************************************************************/
+# define IO_MAX_LOGGED	32	/* disks waiting for log_close */
+
+static struct {
+	FILE			*log;
+	disk_control_ptr	d;
+} io_logged[IO_MAX_LOGGED];
+static int		io_n_logged = 0;
+static pthread_mutex_t	io_lock = PTHREAD_MUTEX_INITIALIZER;
+static char		*io_op_name[IO_N_OPS] = {"read","write","zero"};
+
+static unsigned long long io_clock (void)
+{
+	struct timeval	now;
+
+	gettimeofday (&now,NULL);
+	return (unsigned long long) now.tv_sec*1000000 + now.tv_usec;
+}
+
+/*****************************************************************
+Histogram bucket of a request time (usec): one bucket each below
+IO_SUB, then IO_SUB buckets per power of two
+*****************************************************************/
+static int io_bucket (unsigned long long usec)
+{
+	int	p,
+		b;
+
+	if (usec < IO_SUB) return usec;
+	p = 63 - __builtin_clzll (usec); /* usec is 2^p or more */
+	b = IO_SUB + (p - 2)*IO_SUB + ((usec >> (p - 2)) & (IO_SUB - 1));
+	return b < IO_N_BUCKETS ? b : IO_N_BUCKETS - 1;
+}
+
+/*****************************************************************
+Longest request time (usec) that falls in bucket b
+*****************************************************************/
+static unsigned long long io_bucket_top (int b)
+{
+	int	p;
+
+	if (b < IO_SUB) return b;
+	p = (b - IO_SUB)/IO_SUB + 2;
+	return ((unsigned long long) (IO_SUB + (b & (IO_SUB - 1))) << (p - 2))
+		+ (1ull << (p - 2)) - 1;
+}
+
+/*****************************************************************
+Count a request to disk d
+	op -- IO_READ, IO_WRITE or IO_ZERO
+	t0 -- io_clock when the request started
+	bytes -- bytes moved
+	failed -- the request ended in an error
+	retries -- times the request was continued
+*****************************************************************/
+static void io_note (disk_control_ptr d, int op, unsigned long long t0,
+	unsigned long long bytes, int failed, int retries)
+{
+	io_op_stats		*s;
+	unsigned long long	usec = io_clock() - t0,
+				max;
+
+	if (d->io == NULL) return;
+	s = &d->io->op[op];
+	__sync_fetch_and_add (&s->requests,1);
+	__sync_fetch_and_add (&s->bytes,bytes);
+	if (retries) __sync_fetch_and_add (&s->retries,retries);
+	if (failed) __sync_fetch_and_add (&s->errors,1);
+	__sync_fetch_and_add (&s->usec,usec);
+	__sync_fetch_and_add (&s->hist[io_bucket(usec)],1);
+	while ((max = s->max_usec) < usec &&
+		!__sync_bool_compare_and_swap (&s->max_usec,max,usec));
+}
+
+/*****************************************************************
+Request time (usec) below which fraction q of the requests fall
+*****************************************************************/
+static unsigned long long io_percentile (io_op_stats *s, double q)
+{
+	unsigned long long	want = (unsigned long long) (q*s->requests + 0.999999),
+				n = 0,
+				top;
+	int			b;
+
+	for (b = 0; b < IO_N_BUCKETS; b++) {
+		n += s->hist[b];
+		if (n >= want) break;
+	}
+	if (b == IO_N_BUCKETS) return s->max_usec;
+	top = io_bucket_top (b);
+	return top < s->max_usec ? top : s->max_usec;
+}
+
+/*****************************************************************
+Note that disk d is logged to log (called by log_disk)
+*****************************************************************/
+static void io_stats_register (FILE *log, disk_control_ptr d)
+{
+	int	i;
+
+	if (d->io == NULL) return;
+	pthread_mutex_lock (&io_lock);
+	for (i = 0; i < io_n_logged; i++)
+		if (io_logged[i].log == log && io_logged[i].d == d) break;
+	if (i == io_n_logged && io_n_logged < IO_MAX_LOGGED) {
+		io_logged[i].log = log;
+		io_logged[i].d = d;
+		io_n_logged++;
+	}
+	pthread_mutex_unlock (&io_lock);
+}
+
+/*****************************************************************
+Write the I/O statistics section for disk d to log
+*****************************************************************/
+static void io_stats_print (FILE *log, disk_control_ptr d)
+{
+	io_op_stats		*s;
+	unsigned long long	wait = 0,
+				wall = io_clock() - ((unsigned long long)
+					d->io->opened.tv_sec*1000000 + d->io->opened.tv_usec);
+	int			op;
+
+	fprintf (log,"==== I/O statistics %s\n",d->dev);
+	fprintf (log,"%-5s %10s %14s %7s %6s %9s %9s %9s %8s\n","op","requests",
+		"bytes","retries","errors","p50_us","p99_us","max_us","MB/s");
+	for (op = 0; op < IO_N_OPS; op++) {
+		s = &d->io->op[op];
+		if (!s->requests) continue;
+		wait += s->usec;
+		fprintf (log,"%-5s %10llu %14llu %7llu %6llu %9llu %9llu %9llu %8.1f\n",
+			io_op_name[op],s->requests,s->bytes,s->retries,s->errors,
+			io_percentile (s,0.50),io_percentile (s,0.99),s->max_usec,
+			s->usec ? (double) s->bytes/s->usec : 0.0);
+	}
+	fprintf (log,"io_wait %.1f s wall %.1f s ",wait/1e6,wall/1e6);
+	if (wait <= wall) fprintf (log,"other/compute %.1f s\n",(wall - wait)/1e6);
+	else fprintf (log,"other/compute overlapped\n");
+}
+
+/*****************************************************************
+Write the I/O statistics of each disk logged to log (called by
+log_close) and forget them
+*****************************************************************/
+static void io_stats_log (FILE *log)
+{
+	int	i,
+		k = 0;
+
+	pthread_mutex_lock (&io_lock);
+	for (i = 0; i < io_n_logged; i++)
+		if (io_logged[i].log == log) io_stats_print (log,io_logged[i].d);
+		else io_logged[k++] = io_logged[i];
+	io_n_logged = k;
+	pthread_mutex_unlock (&io_lock);
+}
+
 /*****************************************************************
 Compute elapsed time and close a log file
 *****************************************************************/
@@ -353,6 +613,9 @@ void log_close (FILE *log, /* log file */
 			min, /* minutes for elapsed time after whole hours deducted */
 			sec, /* seconds of elapsed run time after hours & minutes */
 			hours; /* hours of elapsed time */
+	char		when[32]; /* ctime_r: jobs on several threads close logs at once */
+
+	io_stats_log (log); /* I/O statistics of the disks logged here */
 
 	time(&till); /* get current time */
 	et = till - from; /* elapsed time in seconds */
@@ -361,8 +624,8 @@ void log_close (FILE *log, /* log file */
 	hours = tmin/60; /* hours elapsed time */
 	min = tmin%60; /* fraction of last hour in whole minutes */
    
-	fprintf (log,"run start %s",ctime(&from));
-	fprintf (log,"run finish %s",ctime(&till));
+	fprintf (log,"run start %s",ctime_r(&from,when));
+	fprintf (log,"run finish %s",ctime_r(&till,when));
 
 	fprintf (log,"elapsed time %lu:%lu:%lu\n",hours,min,sec);
 	fprintf (log,"Normal exit\n"); 
@@ -409,62 +672,165 @@ void log_disk(	FILE *log, /* log file */
 	}
 
 	fprintf (log,"Model (%s) serial # (%s)\n",d->model_no,d->serial_no);
+	io_stats_register (log,d);
+}
+
+/*****************************************************************
+Progress of a long loop (see progress_rec in zbios.h). The loop only
+calls progress_add; the ticker thread below does the rest.
+*****************************************************************/
+# define PROGRESS_EVERY_PC	5	/* a progress line every 5% */
+
+static progress_ptr	progress_live = NULL; /* records not yet ended */
+static pthread_mutex_t	progress_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*****************************************************************
+Rewrite the DITT_PROGRESS file with a line for each live record.
+Call with progress_list_lock held.
+*****************************************************************/
+static void progress_status (char *name)
+{
+	progress_ptr	q;
+	FILE		*f;
+
+	if (name == NULL || (f = fopen (name,"w")) == NULL) return;
+	for (q = progress_live; q; q = q->next)
+		fprintf (f,"%s%llu %llu %.1f %.1f %lu\n",q->tag,q->from + q->done,q->to,
+			q->pc,q->mb_per_sec,q->remains);
+	fclose (f);
 }
 
 /*****************************************************************
-Give progress and completion time feedback to a user
-	Intent is to call this on each pass of a loop that goes
-	from "from" upto "to".
-	start -- time the loop entered
-	from  -- starting value of loop index
-	at    -- current value of loop index
-	to    -- terminal value of loop
+Print one progress line and update the DITT_PROGRESS file
+	p -- the loop's progress
+	done -- sectors done
 *****************************************************************/
-void feedback (time_t start, off_t from, off_t at,
-					off_t to)
+static void progress_show (progress_ptr p, off_t done, int print)
 {
-	time_t		now;
-	int		every_pc = 5,
-			n_feed = 100/every_pc; /* give feedback every n_feed% */
-	off_t		feed = (to - from)/n_feed;
+	struct timeval	now;
+	double		secs;
+	off_t		n = p->to - p->from,
+			at = p->from + done;
 	unsigned long	et,
-			hr,
-			min,
-			tmin,
-			sec; /* estimated elapsed time */
-	float		pc, /* percent completed */
-			fat,
-			ns; /* number completed */
-	static int	first = 1; /* first time called switch */
-
-	at++;
-	if (feed == 0) feed = 1;
-	if (first) {/* first time through tell the user how often to
-			expect feed back */
-		first = 0;
-		printf ("Feedback every %llu sectors (%d%%) of %llu\n",feed,every_pc,
-			to-from);
-	}
-
-	if (((at - from)%feed) && (at != to)) return;
-	if (from)
-		printf ("at %llu (%llu) of %llu (%llu) from %llu",
-			at,at-from,to,to-from,from);
-	else printf ("at %llu of %llu",at,to);
-
-	fat = at - from;
-	ns = to - from;
-	pc = (100.00*fat)/ns; /* pc = percent completed so far */
-	time(&now);
-	et = (now - start)*(ns - fat)/fat; /* et estimates time remaining */
-	tmin = et/60;
-	hr = tmin/60;
-	min = tmin%60;
-	sec = et%60;
-
-	printf (" %5.1f%%    %lu:%02lu:%02lu remains on %s",pc,hr,min,
-		sec,ctime(&now));
-	return;
+			tmin;
+	char		when[32];
+
+	gettimeofday (&now, NULL);
+	secs = (now.tv_sec - p->started.tv_sec) + (now.tv_usec - p->started.tv_usec)/1e6;
+	pthread_mutex_lock (&progress_list_lock);
+	p->pc = n ? (100.00*done)/n : 100.00;
+	p->mb_per_sec = secs > 0 ? (done*(double) BYTES_PER_SECTOR)/(1e6*secs) : 0;
+	p->remains = done ? (unsigned long) (secs*(n - done)/done) : 0;
+	progress_status (p->status_file);
+	pthread_mutex_unlock (&progress_list_lock);
+
+	if (print) {
+		if (p->from)
+			printf ("%sat %llu (%llu) of %llu (%llu) from %llu",
+				p->tag,at,done,p->to,n,p->from);
+		else printf ("%sat %llu of %llu",p->tag,at,p->to);
+		et = p->remains;
+		tmin = et/60;
+		printf (" %5.1f%% %7.1f MB/s    %lu:%02lu:%02lu remains on %s",p->pc,
+			p->mb_per_sec,tmin/60,tmin%60,et%60,ctime_r(&now.tv_sec,when));
+	}
+}
+
+/*****************************************************************
+Ticker thread: once a second look at the count, print a line each
+time another 5% is done
+*****************************************************************/
+static void *progress_ticker (void *arg)
+{
+	progress_ptr	p = (progress_ptr) arg;
+	struct timeval	now;
+	struct timespec	wake;
+	off_t		done;
+
+	pthread_mutex_lock (&p->lock);
+	while (!p->stop) {
+		gettimeofday (&now, NULL);
+		wake.tv_sec = now.tv_sec + 1;
+		wake.tv_nsec = now.tv_usec*1000;
+		pthread_cond_timedwait (&p->wake, &p->lock, &wake);
+		if (p->stop) break;
+		done = __sync_fetch_and_add (&p->done, 0);
+		progress_show (p, done, done >= p->next_mark);
+		if (done >= p->next_mark) p->next_mark = (done/p->feed + 1)*p->feed;
+	}
+	pthread_mutex_unlock (&p->lock);
+	return NULL;
+}
+
+/*****************************************************************
+Start reporting progress of a loop that goes from "from" up to "to"
+	tag -- put in front of each line ("" for none)
+	returns the progress record to give to progress_add & progress_end
+*****************************************************************/
+progress_ptr progress_start (char *tag, off_t from, off_t to)
+{
+	progress_ptr	p;
+
+	if ((p = (progress_ptr) calloc (1, sizeof(progress_rec))) == NULL) {
+		printf("Unable to allocate memory!\n");
+		exit(1);
+	}
+	strncpy (p->tag, tag, NAME_LENGTH - 1);
+	p->from = from;
+	p->to = to;
+	p->feed = (to - from)/(100/PROGRESS_EVERY_PC);
+	if (p->feed == 0) p->feed = 1;
+	p->next_mark = p->feed;
+	p->status_file = getenv ("DITT_PROGRESS");
+	gettimeofday (&p->started, NULL);
+	pthread_mutex_init (&p->lock, NULL);
+	pthread_cond_init (&p->wake, NULL);
+	pthread_mutex_lock (&progress_list_lock);
+	p->next = progress_live;
+	progress_live = p;
+	pthread_mutex_unlock (&progress_list_lock);
+	printf ("%sFeedback every %llu sectors (%d%%) of %llu\n",p->tag,p->feed,
+		PROGRESS_EVERY_PC,to - from);
+	if (pthread_create (&p->ticker, NULL, progress_ticker, p) == 0)
+		p->ticking = 1;
+	return p;
+}
+
+/*****************************************************************
+Count n more sectors done. Safe to call from any thread.
+*****************************************************************/
+void progress_add (progress_ptr p, off_t n)
+{
+	__sync_fetch_and_add (&p->done, n);
+}
+
+/*****************************************************************
+Stop the ticker, print the final line and free p
+*****************************************************************/
+void progress_end (progress_ptr p)
+{
+	progress_ptr	*q;
+
+	if (p->ticking) {
+		pthread_mutex_lock (&p->lock);
+		p->stop = 1;
+		pthread_cond_signal (&p->wake);
+		pthread_mutex_unlock (&p->lock);
+		pthread_join (p->ticker, NULL);
+	}
+	progress_show (p, p->done, 1);
+	pthread_mutex_lock (&progress_list_lock);
+	for (q = &progress_live; *q; q = &(*q)->next)
+		if (*q == p) {
+			*q = p->next;
+			break;
+		}
+	/* the last one leaves its final line */
+	if (progress_live) progress_status (p->status_file);
+	pthread_mutex_unlock (&progress_list_lock);
+	pthread_mutex_destroy (&p->lock);
+	pthread_cond_destroy (&p->wake);
+	free (p);
 }
 
 /*****************************************************************
@@ -476,6 +842,7 @@ int disk_write (disk_control_ptr d, chs_addr *a)
 	off_t	lba,
 		lseek_err;
 	ssize_t	write_err;
+	unsigned long long t0;
 
 	/* convert C/H/S address to a Logical Block Address */
 	lba = (a->cylinder*d->disk_max.head + a->head)*63 + a->sector - 1;
@@ -492,7 +859,9 @@ int disk_write (disk_control_ptr d, chs_addr *a)
 	}
 
 	/* do the write to the hard drive */
+	t0 = io_clock();
 	write_err = write(d->fd, d->buffer, DISK_MAX_SECTORS * BYTES_PER_SECTOR);
+	io_note (d, IO_WRITE, t0, write_err > 0 ? write_err : 0, write_err < 0, 0);
 
 	if (!write_err) {
 		/* end of file */
@@ -514,6 +883,7 @@ int disk_read (disk_control_ptr d, chs_addr *a)
 	off_t	lseek_err,
 		lba;
 	ssize_t	read_err;  
+	unsigned long long t0;
 
 	/* convert C/H/S address to a Logical Block Address */
 	lba = (a->cylinder*d->disk_max.head + a->head)*63 + a->sector - 1;
@@ -529,7 +899,9 @@ int disk_read (disk_control_ptr d, chs_addr *a)
 	}
 
 	/* do the read from the hard drive */
+	t0 = io_clock();
 	read_err = read(d->fd, d->buffer, DISK_MAX_SECTORS * BYTES_PER_SECTOR /* 63 sectors X 512 bytes */);
+	io_note (d, IO_READ, t0, read_err > 0 ? read_err : 0, read_err < 0, 0);
 
 	if (!read_err) {
 		/* end of file */
@@ -575,6 +947,110 @@ int disk_read_lba (disk_control_ptr d, off_t lba)
 	return 0;
 }
 
+/*****************************************************************
+Read n sectors from disk d starting at address lba into buf
+Unlike disk_read this does not go through the track buffer, so
+many tracks can be moved with one request. Short reads are
+continued until all n sectors are in or the end of the disk
+*****************************************************************/
+int read_sectors (disk_control_ptr d, off_t lba, off_t n, unsigned char *buf)
+{
+	size_t	want = n*BYTES_PER_SECTOR, /* bytes still to read */
+		got = 0; /* bytes read so far */
+	ssize_t	read_err;
+	int	tries = 0;
+	unsigned long long t0 = io_clock();
+
+	while (got < want) {
+		tries++;
+		read_err = pread(d->fd, buf + got, want - got,
+			lba*BYTES_PER_SECTOR + got);
+		if (!read_err) {
+			/* end of file */
+			printf("an attempt was made to access an invalid address(LBA): %llu on %s\n",
+				lba + got/BYTES_PER_SECTOR, d->dev);
+			io_note (d, IO_READ, t0, got, 1, tries - 1);
+			return 1;
+		} else if (read_err < 0) {
+			if (errno == EINTR) continue;
+			printf("Error: %i (%s) has occurred attempting to read from %s (lba: %llu)\n",
+				errno, strerror(errno), d->dev, lba + got/BYTES_PER_SECTOR);
+			io_note (d, IO_READ, t0, got, 1, tries - 1);
+			return read_err;
+		}
+		got += read_err;
+	}
+	io_note (d, IO_READ, t0, got, 0, tries - 1);
+
+	return 0;
+}
+
+/*****************************************************************
+Write n sectors from buf to disk d starting at address lba
+(the write counterpart of read_sectors)
+*****************************************************************/
+int write_sectors (disk_control_ptr d, off_t lba, off_t n, unsigned char *buf)
+{
+	size_t	want = n*BYTES_PER_SECTOR, /* bytes still to write */
+		put = 0; /* bytes written so far */
+	ssize_t	write_err;
+	int	tries = 0;
+	unsigned long long t0 = io_clock();
+
+	while (put < want) {
+		tries++;
+		write_err = pwrite(d->fd, buf + put, want - put,
+			lba*BYTES_PER_SECTOR + put);
+		if (!write_err) {
+			/* end of file */
+			printf("An attempt was made to access an invalid address(LBA): %llu on %s\n",
+				lba + put/BYTES_PER_SECTOR, d->dev);
+			io_note (d, IO_WRITE, t0, put, 1, tries - 1);
+			return 1;
+		} else if (write_err < 0) {
+			if (errno == EINTR) continue;
+			printf("Error: %i (%s) has occurred attempting to write to %s (lba: %llu)\n",
+				errno, strerror(errno), d->dev, lba + put/BYTES_PER_SECTOR);
+			io_note (d, IO_WRITE, t0, put, 1, tries - 1);
+			return write_err;
+		}
+		put += write_err;
+	}
+	io_note (d, IO_WRITE, t0, put, 0, tries - 1);
+
+	return 0;
+}
+
+/*****************************************************************
+Have the kernel zero n sectors of disk d starting at address lba
+(BLKZEROOUT). The kernel asks the device for write zeroes (or write
+same) and, where the device has neither, writes the zeroes itself.
+It never discards (unmaps) to do it: the request is made with
+BLKDEV_ZERO_NOUNMAP, so every sector is really written. No data
+crosses into user space either way.
+	returns 0 if zeroed, ZERO_UNSUPPORTED if the ioctl is refused
+	(in practice: d is not a block device, e.g. an image file),
+	or the (negative) error otherwise
+*****************************************************************/
+int zero_sectors (disk_control_ptr d, off_t lba, off_t n)
+{
+	unsigned long long	range[2],
+				t0 = io_clock();
+
+	range[0] = lba*BYTES_PER_SECTOR; /* start byte */
+	range[1] = n*BYTES_PER_SECTOR; /* number of bytes */
+	if (ioctl (d->fd, BLKZEROOUT, &range) == 0) {
+		io_note (d, IO_ZERO, t0, range[1], 0, 0);
+		return 0;
+	}
+	if (errno == ENOTTY || errno == EINVAL || errno == EOPNOTSUPP)
+		return ZERO_UNSUPPORTED;
+	io_note (d, IO_ZERO, t0, 0, 1, 0);
+	printf("Error: %i (%s) has occurred attempting to zero %s (lba: %llu)\n",
+		errno, strerror(errno), d->dev, lba);
+	return -1;
+}
+
 /*****************************************************************
 Open a disk, return a pointer to a disk_control_rec
 The disk_control_rec contains a description of the disk ...
@@ -597,6 +1073,9 @@ disk_control_ptr open_disk (char *drive, int *err)
 
 	/* set drive name */
 	strncpy(((char *) &d->dev), drive, NAME_LENGTH - 1);
+	d->pt_status = PT_NOT_READ; /* partition table read on first use */
+	d->io = (io_stats_ptr) calloc (1, sizeof(io_stats));
+	if (d->io) gettimeofday (&d->io->opened, NULL);
 
 	/* set drive type */
 	if (drive[5] == 's')
@@ -614,6 +1093,48 @@ disk_control_ptr open_disk (char *drive, int *err)
 	return d;
 }
 
+/*****************************************************************
+Open an image file (or a disk) to be read like a disk
+A block device goes to open_disk. For anything else there is no
+geometry to probe: the size gives the number of sectors (bytes past
+the last whole sector are left out) and the C/H/S limits are made up
+from 255 heads of 63 sectors. The file is opened read only.
+*****************************************************************/
+disk_control_ptr open_image (char *name, int *err)
+{
+	disk_control_ptr	d;
+	struct stat		st;
+
+	if (stat (name,&st) == 0 && S_ISBLK(st.st_mode)) return open_disk (name,err);
+	d = (disk_control_ptr) calloc (1,sizeof(disk_control_block));
+	if (d == NULL) { /* out of memory */
+		*err = 3000;
+		return NULL;
+	}
+	strncpy(d->dev, name, NAME_LENGTH - 1);
+	d->pt_status = PT_NOT_READ;
+	d->drive_type = DRIVE_IS_SCSI; /* not IDE: no identify data */
+	d->io = (io_stats_ptr) calloc (1, sizeof(io_stats));
+	if (d->io) gettimeofday (&d->io->opened, NULL);
+	d->fd = open (name,O_RDONLY);
+	if (d->fd < 0 || fstat (d->fd,&st)) {
+		printf("Unable to open %s ", name);
+		*err = 1;
+		return d;
+	}
+	d->n_sectors = st.st_size/BYTES_PER_SECTOR;
+	if (st.st_size % BYTES_PER_SECTOR)
+		printf ("%s: last %llu bytes are not a whole sector and are left out\n",
+			name,(off_t) (st.st_size % BYTES_PER_SECTOR));
+	n_heads(d) = 255;
+	d->disk_max.sector = DISK_MAX_SECTORS;
+	n_cylinders(d) = (d->n_sectors + 255*DISK_MAX_SECTORS - 1)/(255*DISK_MAX_SECTORS);
+	strcpy (d->model_no,"image file");
+	*err = 0;
+	printf ("Open image %s %llu sectors\n",name,d->n_sectors);
+	return d;
+}
+
 /*****************************************************************
 Convert LBA value to C/H/S
 *****************************************************************/
@@ -640,98 +1161,213 @@ int read_lba (disk_control_ptr d, off_t lba, unsigned char **b)
 }
 
 /*****************************************************************
-Get a nested partition table entry
-*****************************************************************/
-
-pte_ptr get_sub_part (disk_control_block *d,off_t start,
-	off_t base,int *status)
-{
-	mbr_sector *mbr;
-	pte_ptr	p,q;
-	int 		i;
-	off_t at = base + start;
-	chs_addr a;
-
-	lba_to_chs(d,at,&a);
-	*status = disk_read (d,&a);
-	mbr = (mbr_sector *)(&(d->buffer));
-	if (*status) return NULL;
-	if (mbr->sig == 0xAA55) {
-		p = q = (pte_ptr) malloc (sizeof(pte_rec));
-		for (i = 0; i < 2; i++){
-			p->is_boot = mbr->pe[i].bootid;
-			p->type = mbr->pe[i].type_code;
-			p->lba_start = mbr->pe[i].starting_lba_sector;
-			p->lba_length = mbr->pe[i].n_sectors;
-			p->start.cylinder = mbr->pe[i].start_cylinder |
-				 ((mbr->pe[i].start_sector&0xC0)<<2);
-			p->start.head =  mbr->pe[i].start_head;
-			p->start.sector = mbr->pe[i].start_sector & 0x3F;
-			p->end.cylinder = mbr->pe[i].end_cylinder |
-				 ((mbr->pe[i].end_sector&0xC0)<<2);
-			p->end.head =  mbr->pe[i].end_head;
-			p->end.sector = mbr->pe[i].end_sector & 0x3F;
-			if (i == 0){
-				p->next = (pte_ptr) malloc (sizeof(pte_rec));
-				p = p->next;
-			}
-			else {
-				if ((mbr->pe[1].type_code == 0x05) ||
-					 (mbr->pe[1].type_code == 0x0F)
-					 ){
-					p->next = get_sub_part(d,p->lba_start,base,status);
-				}
-				else p->next = NULL;
-			}
+Partition layout
+The partition table is read once per disk and kept in the
+disk_control_block: the MBR is read with a single sector read, and
+each EBR of an extended partition chain is read the same way (one
+sector, not a whole track). Entries of the chains come from a pool
+in the disk_control_block, so the chain length is bounded (this also
+stops a looping EBR chain). get_partition_table hands out copies
+of the cached table; save_partition_table and load_partition_table
+let a table read by one program be reused by the next.
+*****************************************************************/
+
+/*****************************************************************
+Convert entry i of a partition table sector to a pte_rec (the
+entry is copied out first: it is packed, so may not be aligned)
+*****************************************************************/
+void decode_pte (mbr_sector *mbr, int i, pte_ptr p)
+{
+	partition_table_rec	e = mbr->pe[i];
+
+	p->is_boot = e.bootid;
+	p->type = e.type_code;
+	p->lba_start = e.starting_lba_sector;
+	p->lba_length = e.n_sectors;
+	p->start.cylinder = e.start_cylinder |
+		 ((e.start_sector&0xC0)<<2);
+	p->start.head =  e.start_head;
+	p->start.sector = e.start_sector & 0x3F;
+	p->end.cylinder = e.end_cylinder |
+		 ((e.end_sector&0xC0)<<2);
+	p->end.head =  e.end_head;
+	p->end.sector = e.end_sector & 0x3F;
+}
+
+/*****************************************************************
+Follow the chain of EBRs of the extended partition that starts at
+base. Each EBR gives two entries: a logical partition and a link
+to the next EBR (relative to base). link is where to hang the
+chain. Entries are taken from d->pt_sub.
+*****************************************************************/
+int get_sub_part (disk_control_block *d, off_t base, pte_ptr *link)
+{
+	physical_sector	sec; /* the EBR */
+	mbr_sector	*mbr = (mbr_sector *) sec;
+	off_t		at = base; /* first EBR is at the start of the partition */
+	pte_ptr		p;
+	int		status;
+
+	*link = NULL;
+	while (1) {
+		status = read_sectors (d, at, 1, sec);
+		if (status) return status;
+		if (mbr->sig != 0xAA55) return 0;
+		if (d->n_sub + 2 > MAX_SUB_PTE) {
+			printf ("More than %d extended partition table entries on %s\n",
+				MAX_SUB_PTE, d->dev);
+			return 0;
 		}
+		p = &d->pt_sub[d->n_sub];
+		d->n_sub += 2;
+		decode_pte (mbr, 0, p);
+		decode_pte (mbr, 1, p + 1);
+		p->next = p + 1;
+		p[1].next = NULL;
+		*link = p;
+		link = &p[1].next;
+		if (!is_extended(mbr->pe[1].type_code)) return 0;
+		at = base + p[1].lba_start;
 	}
-	else return NULL;
-	return q;
 }
 
 /*****************************************************************
-Get the partition table for disk d and save in pt
+Read the partition table of disk d into the cache
 *****************************************************************/
-int get_partition_table(disk_control_block *d,pte_ptr pt)
+int read_partition_table (disk_control_block *d)
 {
-	mbr_sector *mbr;
-	chs_addr  boot = {0ul,0ul,1ul};
-	int	status,i;
+	physical_sector	sec; /* the MBR */
+	mbr_sector	*mbr = (mbr_sector *) sec;
+	int		status,
+			i;
 
-	status = disk_read (d,&boot);
-	mbr = (mbr_sector *) &(d->buffer);
+	d->n_sub = 0;
+	status = read_sectors (d, (off_t) 0, 1, sec);
 	if (status) return status;
 	if (mbr->sig != 0xAA55) return -1;
-	else {
-		for (i = 0; i < 4; i++){
-			status = disk_read (d,&boot); /* really needed */
-			pt[i].is_boot = mbr->pe[i].bootid;
-			pt[i].type = mbr->pe[i].type_code;
-			pt[i].lba_start = mbr->pe[i].starting_lba_sector;
-			pt[i].lba_length = mbr->pe[i].n_sectors;
-			pt[i].start.cylinder = mbr->pe[i].start_cylinder |
-				 ((mbr->pe[i].start_sector&0xC0)<<2);
-			pt[i].start.head =  mbr->pe[i].start_head;
-			pt[i].start.sector = mbr->pe[i].start_sector & 0x3F;
-			pt[i].end.cylinder = mbr->pe[i].end_cylinder |
-				 ((mbr->pe[i].end_sector&0xC0)<<2);
-			pt[i].end.head =  mbr->pe[i].end_head;
-			pt[i].end.sector = mbr->pe[i].end_sector & 0x3F;
-			if ((mbr->pe[i].type_code == 0x05) ||
-				 (mbr->pe[i].type_code == 0x0F)
-				 ){
-					pt[i].next = get_sub_part (d,(off_t)0ul,pt[i].lba_start,&status);
-					if (status) return status;
-			}
-			else {
-				pt[i].next = NULL;
-			}
-		 }
-
+	for (i = 0; i < 4; i++){
+		decode_pte (mbr, i, &d->pt[i]);
+		if (is_extended(mbr->pe[i].type_code)) {
+			status = get_sub_part (d, d->pt[i].lba_start, &d->pt[i].next);
+			if (status) return status;
+		}
+		else {
+			d->pt[i].next = NULL;
+		}
 	}
-	return status;
+	return 0;
+}
+
+/*****************************************************************
+Get the partition table for disk d and save in pt
+The table is read from the disk only the first time; the entries
+of extended partitions (pt[i].next) belong to d.
+*****************************************************************/
+int get_partition_table(disk_control_block *d,pte_ptr pt)
+{
+	if (d->pt_status == PT_NOT_READ) d->pt_status = read_partition_table (d);
+	if (d->pt_status == 0) memcpy (pt, d->pt, sizeof(d->pt));
+	return d->pt_status;
+}
 
+/*****************************************************************
+Disk identification used to tag a saved partition table:
+serial number without blanks
+*****************************************************************/
+void layout_id (disk_control_ptr d, char *id)
+{
+	int	i;
+
+	strncpy (id, d->serial_no, 20);
+	id[20] = '\0';
+	trim (id);
+	for (i = 0; id[i]; i++) if (id[i] == ' ') id[i] = '_';
+	if (id[0] == '\0') strcpy (id, "-");
 }
+
+/*****************************************************************
+Write the partition table of disk d to f as one record:
+	layout <drive> <serial> <number of sectors> <status>
+	P|S <primary index> <boot> <type> <start> <length> <start C/H/S> <end C/H/S>
+	end
+S lines follow the P line of the extended partition they belong to
+*****************************************************************/
+void save_partition_table (FILE *f, disk_control_ptr d)
+{
+	pte_rec	pt[4];
+	pte_ptr	sub;
+	char	id[21];
+	int	status = get_partition_table (d, pt),
+		i;
+
+	layout_id (d, id);
+	fprintf (f, "layout %s %s %llu %d\n", d->dev, id, d->n_sectors, status);
+	for (i = 0; (status == 0) && (i < 4); i++)
+		for (sub = &pt[i]; sub; sub = sub->next)
+			fprintf (f, "%c %d %u %u %llu %llu %llu/%llu/%llu %llu/%llu/%llu\n",
+				(sub == &pt[i]) ? 'P' : 'S', i, sub->is_boot, sub->type,
+				sub->lba_start, sub->lba_length,
+				sub->start.cylinder, sub->start.head, sub->start.sector,
+				sub->end.cylinder, sub->end.head, sub->end.sector);
+	fprintf (f, "end\n");
+}
+
+/*****************************************************************
+Look in f for a partition table saved for disk d (same drive,
+serial number and size). If there is one, it becomes the cached
+partition table of d and 0 is returned; the last matching record
+in the file is used.
+*****************************************************************/
+int load_partition_table (FILE *f, disk_control_ptr d)
+{
+	char		line[200],
+			dev[NAME_LENGTH],
+			id[NAME_LENGTH],
+			my_id[21],
+			kind;
+	off_t		ns;
+	int		status,
+			found = 0,
+			in_rec = 0, /* reading the entries of a matching record */
+			i, boot, type;
+	pte_ptr		p,
+			last = NULL; /* last entry of current chain */
+
+	layout_id (d, my_id);
+	while (fgets (line, sizeof(line), f)) {
+		if (sscanf (line, "layout %79s %79s %llu %d", dev, id, &ns, &status) == 4) {
+			in_rec = (strcmp (dev, d->dev) == 0) && (strcmp (id, my_id) == 0) &&
+				(ns == d->n_sectors);
+			if (in_rec) {
+				found = 1;
+				last = NULL;
+				d->pt_status = status;
+				d->n_sub = 0;
+				memset (d->pt, 0, sizeof(d->pt));
+			}
+			continue;
+		}
+		if (!in_rec) continue;
+		if (strncmp (line, "end", 3) == 0) {in_rec = 0; continue;}
+		if (sscanf (line, "%c %d", &kind, &i) != 2) continue;
+		if ((i < 0) || (i > 3)) continue;
+		if (kind == 'P') p = &d->pt[i];
+		else if ((kind == 'S') && last && (d->n_sub < MAX_SUB_PTE))
+			p = &d->pt_sub[d->n_sub++];
+		else continue;
+		sscanf (line, "%*c %*d %d %d %llu %llu %llu/%llu/%llu %llu/%llu/%llu",
+			&boot, &type, &p->lba_start, &p->lba_length,
+			&p->start.cylinder, &p->start.head, &p->start.sector,
+			&p->end.cylinder, &p->end.head, &p->end.sector);
+		p->is_boot = boot;
+		p->type = type;
+		p->next = NULL;
+		if (kind == 'S') last->next = p;
+		last = p;
+	}
+	return !found;
+}
+
 /*****************************************************************
 Map common partition type codes to an ASCII string
 *****************************************************************/
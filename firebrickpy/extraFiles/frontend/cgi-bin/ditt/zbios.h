@@ -28,6 +28,8 @@ redistribution.
 /* Modified by Kelsey Rider, NIST/SDCT June 2004 */
 # include <time.h>
 # include <sys/types.h>
+# include <sys/time.h>
+# include <pthread.h>
 
 #define DRIVE_IS_IDE 0
 #define DRIVE_IS_SCSI 1
@@ -42,6 +44,9 @@ redistribution.
 #define BUFF_OFF 30
 #define MAX_OFF_T 0xFFFFFFFFFFFFFFFFull
 #define MAX_PARTITIONS 25
+#define MAX_SUB_PTE (2*MAX_PARTITIONS) /* extended partition entries kept per disk */
+#define PT_NOT_READ (-2) /* pt_status: partition table not read yet */
+#define ZERO_UNSUPPORTED 2 /* zero_sectors: no zero out (not a block device) */
 
 #define CHUNK_PARTITION 'P'
 #define CHUNK_BOOT 'B'
@@ -64,6 +69,50 @@ typedef struct {
 		sector;
 } chs_addr; /* C/H/S disk address */
 
+/******************************************************************************
+Data structure to keep partition table information
+******************************************************************************/
+
+typedef struct pte_struct pte_rec, *pte_ptr;
+struct pte_struct {
+	pte_ptr		next;
+	chs_addr	start,
+			end;
+	off_t		lba_start,
+			lba_length;
+	unsigned char	is_boot,
+			type;
+};
+
+
+/******************************************************************************
+I/O statistics of a disk, kept by the zbios I/O functions (one record per
+read, write or zero out system call) and written to the log by log_close.
+Request times go in a histogram of IO_SUB buckets per power of two
+microseconds, enough for p50/p99 to within 25%.
+******************************************************************************/
+#define IO_READ		0
+#define IO_WRITE	1
+#define IO_ZERO		2
+#define IO_N_OPS	3
+#define IO_SUB		4 /* histogram buckets per power of two */
+#define IO_N_BUCKETS	(IO_SUB*40)
+
+typedef struct {
+	unsigned long long	requests,
+				bytes,
+				retries, /* interrupted or short transfers continued */
+				errors,
+				usec,	/* time spent in requests */
+				max_usec,
+				hist[IO_N_BUCKETS];
+} io_op_stats;
+
+typedef struct {
+	io_op_stats	op[IO_N_OPS];
+	struct timeval	opened;	/* when the disk was opened */
+} io_stats, *io_stats_ptr;
+
 /******************************************************************************
 The disk_control_block contains all information about a disk drive
 Disk geometry as seen by legacy BIOS (interrupt 13/command 0x08): logical disk
@@ -73,6 +122,8 @@ A buffer holding 63 sectors: buffer
 Drive number: drive
 Flag indicating XBIOS active: use_bios_x
 IDE Drive information: ide_info
+Partition table, read on first use: pt, pt_sub
+I/O statistics: io (shared by copies of the block)
 ******************************************************************************/
 
 typedef unsigned char physical_sector[BYTES_PER_SECTOR]; /* a sector of 512 bytes */
@@ -89,6 +140,11 @@ struct disk_struct {
 	chs_addr	disk_max;	/* number of cyl, number of head */
         int		geometry_is_real;/* 1 if able to find C/H/S; 0 if unable */
         physical_track	buffer;		/* 63 sectors (1 track) buffer[sector][byte] */
+	int		pt_status;	/* get_partition_table status or PT_NOT_READ */
+	pte_rec		pt[4];		/* partition table (primary entries) */
+	pte_rec		pt_sub[MAX_SUB_PTE]; /* extended partition entries */
+	int		n_sub;		/* number of pt_sub entries used */
+	io_stats_ptr	io;		/* I/O statistics */
 };
 
 /******************************************************************************
@@ -117,22 +173,6 @@ typedef struct { /* partition table in Master Boot Record */
 	unsigned short 		sig;  /* partition table signature word 0xAA55 */
 }mbr_sector,*mbr_ptr;
 
-/******************************************************************************
-Data structure to keep partition table information
-******************************************************************************/
-
-typedef struct pte_struct pte_rec, *pte_ptr;
-struct pte_struct {
-	pte_ptr		next;
-	chs_addr	start,
-			end;
-	off_t		lba_start,
-			lba_length;
-	unsigned char	is_boot,
-			type;
-};
-
-
 /******************************************************************************
 Data structure to track ranges of integers. The compare programs examine each
 disk sector in LBA address sequence and assign each sector to a catagory, e.g.,
@@ -149,6 +189,58 @@ typedef struct { /* structure to keep a list of ranges */
 	} range_list,*range_ptr;
 
 
+/******************************************************************************
+State of the DISKWIPE pattern generator. Each sector written by diskwipe
+starts with the ASCII address "ccccc/hhh/ss llllllllllll" (C/H/S and LBA of
+the sector) and a NULL; the rest of the sector is the fill byte. The address
+string of the next sector is kept in hdr and stepped from sector to sector
+like an odometer instead of being formatted each time.
+******************************************************************************/
+typedef struct {
+	off_t		lba,	/* LBA of the next sector */
+			cylinder, /* C/H/S of the next sector (as written in the pattern) */
+			head,
+			sector,
+			heads;	/* heads per cylinder used for the C/H/S in the pattern */
+	unsigned char	fill;	/* fill byte */
+	int		len,	/* strlen(hdr) */
+			c_end,	/* index of the last digit of each field in hdr */
+			h_end,
+			s_end;
+	char		hdr[48]; /* address string of the next sector */
+} wipe_pattern, *wipe_pattern_ptr;
+
+/******************************************************************************
+Progress of a long loop from "from" up to "to" (in sectors). The loop,
+or each of its threads, only adds what it has done (progress_add, one
+atomic add). A ticker thread looks at the count once a second, works
+out percent done, MB/s and time remaining, and prints a line each time
+another 5% is done. Each tick also rewrites the file named by the
+DITT_PROGRESS environment variable, one line "<tag>at to percent MB/s
+seconds-left" for every progress record live in the program, so the
+jobs of a multi-drive run do not overwrite each other.
+******************************************************************************/
+typedef struct progress_rec *progress_ptr;
+typedef struct progress_rec {
+	char		tag[NAME_LENGTH]; /* put in front of each line */
+	off_t		from,	/* the loop runs from ... */
+			to,	/* ... up to */
+			feed,	/* a line every feed sectors */
+			next_mark; /* next line when done gets here */
+	volatile off_t	done;	/* sectors done so far */
+	float		pc,	/* figures at the last tick: percent done */
+			mb_per_sec;
+	unsigned long	remains; /* seconds to go */
+	char		*status_file; /* DITT_PROGRESS */
+	progress_ptr	next;	/* next live record (for DITT_PROGRESS) */
+	struct timeval	started;
+	pthread_t	ticker;
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+	int		ticking,
+			stop;
+} progress_rec;
+
 /******************************************************************************
 Function decls for zbios.c
 ******************************************************************************/
@@ -156,14 +248,24 @@ Function decls for zbios.c
 int                     read_lba (disk_control_ptr, off_t, unsigned char **);
 int                     disk_write (disk_control_ptr, chs_addr *);
 int                     disk_read (disk_control_ptr, chs_addr *);
+int                     read_sectors (disk_control_ptr, off_t, off_t, unsigned char *);
+int                     write_sectors (disk_control_ptr, off_t, off_t, unsigned char *);
+int                     zero_sectors (disk_control_ptr, off_t, off_t);
 disk_control_ptr        open_disk (char *, int *);
+disk_control_ptr        open_image (char *, int *);
 void 			lba_to_chs (disk_control_block *, off_t, chs_addr *);
 FILE 			*log_open (char *, char *, char *, char **, int, char **);
 void 			log_close (FILE *,time_t);
 void 			log_disk(FILE *, char *, disk_control_ptr);
 int 			get_partition_table(disk_control_block *,pte_ptr );
+void			save_partition_table(FILE *, disk_control_ptr);
+int			load_partition_table(FILE *, disk_control_ptr);
 void 			print_partition_table(FILE *, pte_rec *, int, int);
-void 			feedback (time_t, off_t, off_t, off_t);
+progress_ptr		progress_start (char *, off_t, off_t);
+void			progress_add (progress_ptr, off_t);
+void			progress_end (progress_ptr);
+void			wipe_pattern_init (wipe_pattern_ptr, off_t, off_t, unsigned char);
+void			wipe_pattern_fill (wipe_pattern_ptr, unsigned char *, off_t);
 range_ptr 	        create_range_list(void);
 void 			add_to_range (range_ptr, off_t );
 void 			print_range_list(FILE *, char *,range_ptr);
@@ -0,0 +1,1163 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+# include <stdio.h>
+# include "zbios.h"
+# include "zhash.h"
+# include <string.h>
+# include <stdlib.h>
+# include <malloc.h>
+# include <fcntl.h>
+# include <pthread.h>
+
+char *SCCS_ZH = "@(#) zhash.c Linux Version 1.0 "\
+"\nhash lib compiled "__DATE__" at "__TIME__"\n"ZH_H_ID;
+
+/*****************************************************************
+Hash Library
+	Digests: MD5 (RFC 1321), SHA-1 and SHA-256 (FIPS 180-2)
+	Kernels: SHA-NI SHA-1/SHA-256 and 8 lane AVX2 MD5 when the CPU has them
+	Disk hashing: one pass over a disk, each digest on its own thread
+*****************************************************************/
+
+static char *names[HASH_N] = {"MD5","SHA1","SHA256"};
+static int sizes[HASH_N] = {16,20,32};
+
+# define ROL(x,n)	(((x) << (n)) | ((x) >> (32 - (n))))
+# define ROR(x,n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+/*****************************************************************
+MD5 block function (64 bytes at b)
+*****************************************************************/
+static const unsigned int md5_k[64] = {
+	0xd76aa478,0xe8c7b756,0x242070db,0xc1bdceee,0xf57c0faf,0x4787c62a,
+	0xa8304613,0xfd469501,0x698098d8,0x8b44f7af,0xffff5bb1,0x895cd7be,
+	0x6b901122,0xfd987193,0xa679438e,0x49b40821,0xf61e2562,0xc040b340,
+	0x265e5a51,0xe9b6c7aa,0xd62f105d,0x02441453,0xd8a1e681,0xe7d3fbc8,
+	0x21e1cde6,0xc33707d6,0xf4d50d87,0x455a14ed,0xa9e3e905,0xfcefa3f8,
+	0x676f02d9,0x8d2a4c8a,0xfffa3942,0x8771f681,0x6d9d6122,0xfde5380c,
+	0xa4beea44,0x4bdecfa9,0xf6bb4b60,0xbebfbc70,0x289b7ec6,0xeaa127fa,
+	0xd4ef3085,0x04881d05,0xd9d4d039,0xe6db99e5,0x1fa27cf8,0xc4ac5665,
+	0xf4292244,0x432aff97,0xab9423a7,0xfc93a039,0x655b59c3,0x8f0ccc92,
+	0xffeff47d,0x85845dd1,0x6fa87e4f,0xfe2ce6e0,0xa3014314,0x4e0811a1,
+	0xf7537e82,0xbd3af235,0x2ad7d2bb,0xeb86d391};
+static const int md5_r[64] = {
+	7,12,17,22,7,12,17,22,7,12,17,22,7,12,17,22,
+	5,9,14,20,5,9,14,20,5,9,14,20,5,9,14,20,
+	4,11,16,23,4,11,16,23,4,11,16,23,4,11,16,23,
+	6,10,15,21,6,10,15,21,6,10,15,21,6,10,15,21};
+
+static void md5_block (unsigned int *s, unsigned char *b)
+{
+	unsigned int	w[16],
+			a = s[0],
+			bb = s[1],
+			c = s[2],
+			d = s[3],
+			f,
+			t;
+	int		i,
+			g;
+
+	for (i = 0; i < 16; i++) /* little endian words */
+		w[i] = b[4*i] | (b[4*i+1] << 8) | (b[4*i+2] << 16)
+			| ((unsigned int) b[4*i+3] << 24);
+	for (i = 0; i < 64; i++) {
+		if (i < 16) {
+			f = (bb & c) | (~bb & d);
+			g = i;
+		} else if (i < 32) {
+			f = (d & bb) | (~d & c);
+			g = (5*i + 1) & 15;
+		} else if (i < 48) {
+			f = bb ^ c ^ d;
+			g = (3*i + 5) & 15;
+		} else {
+			f = c ^ (bb | ~d);
+			g = (7*i) & 15;
+		}
+		t = d;
+		d = c;
+		c = bb;
+		bb = bb + ROL(a + f + md5_k[i] + w[g], md5_r[i]);
+		a = t;
+	}
+	s[0] += a;
+	s[1] += bb;
+	s[2] += c;
+	s[3] += d;
+}
+
+/*****************************************************************
+SHA-1 block function
+*****************************************************************/
+static void sha1_block (unsigned int *s, unsigned char *b)
+{
+	unsigned int	w[80],
+			a = s[0],
+			bb = s[1],
+			c = s[2],
+			d = s[3],
+			e = s[4],
+			t;
+	int		i;
+
+	for (i = 0; i < 16; i++) /* big endian words */
+		w[i] = ((unsigned int) b[4*i] << 24) | (b[4*i+1] << 16)
+			| (b[4*i+2] << 8) | b[4*i+3];
+	for (; i < 80; i++) w[i] = ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+# define SHA1_STEP(f,k) \
+		t = ROL(a,5) + (f) + e + k + w[i]; \
+		e = d; \
+		d = c; \
+		c = ROL(bb,30); \
+		bb = a; \
+		a = t;
+	for (i = 0; i < 20; i++) { SHA1_STEP (d ^ (bb & (c ^ d)),0x5a827999) }
+	for (; i < 40; i++) { SHA1_STEP (bb ^ c ^ d,0x6ed9eba1) }
+	for (; i < 60; i++) { SHA1_STEP ((bb & c) | (d & (bb | c)),0x8f1bbcdc) }
+	for (; i < 80; i++) { SHA1_STEP (bb ^ c ^ d,0xca62c1d6) }
+	s[0] += a;
+	s[1] += bb;
+	s[2] += c;
+	s[3] += d;
+	s[4] += e;
+}
+
+/*****************************************************************
+SHA-256 block function
+*****************************************************************/
+static const unsigned int sha256_k[64] = {
+	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,
+	0x923f82a4,0xab1c5ed5,0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,
+	0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,0xe49b69c1,0xefbe4786,
+	0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+	0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,
+	0x06ca6351,0x14292967,0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,
+	0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,0xa2bfe8a1,0xa81a664b,
+	0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+	0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,
+	0x5b9cca4f,0x682e6ff3,0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,
+	0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2};
+
+static void sha256_block (unsigned int *s, unsigned char *b)
+{
+	unsigned int	w[64],
+			v[8],
+			t1,
+			t2;
+	int		i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = ((unsigned int) b[4*i] << 24) | (b[4*i+1] << 16)
+			| (b[4*i+2] << 8) | b[4*i+3];
+	for (; i < 64; i++)
+		w[i] = (ROR(w[i-2],17) ^ ROR(w[i-2],19) ^ (w[i-2] >> 10)) + w[i-7]
+			+ (ROR(w[i-15],7) ^ ROR(w[i-15],18) ^ (w[i-15] >> 3)) + w[i-16];
+	for (i = 0; i < 8; i++) v[i] = s[i];
+	for (i = 0; i < 64; i++) {
+		t1 = v[7] + (ROR(v[4],6) ^ ROR(v[4],11) ^ ROR(v[4],25))
+			+ ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha256_k[i] + w[i];
+		t2 = (ROR(v[0],2) ^ ROR(v[0],13) ^ ROR(v[0],22))
+			+ ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+		v[7] = v[6];
+		v[6] = v[5];
+		v[5] = v[4];
+		v[4] = v[3] + t1;
+		v[3] = v[2];
+		v[2] = v[1];
+		v[1] = v[0];
+		v[0] = t1 + t2;
+	}
+	for (i = 0; i < 8; i++) s[i] += v[i];
+}
+
+# define BLOCKS(f) static void f##s (unsigned int *s, unsigned char *b, size_t n) \
+	{ for (; n; n--, b += 64) f (s,b); }
+BLOCKS(md5_block)
+BLOCKS(sha1_block)
+BLOCKS(sha256_block)
+
+/*****************************************************************
+Hardware kernels (x86-64). With the SHA extensions (SHA-NI) a SHA-1
+or SHA-256 block takes a few instructions. MD5 has no instructions
+of its own and each step needs the one before, so one message can
+not go faster; instead md5_x8 runs eight messages side by side, one
+per 32 bit lane of an AVX2 register (see hash_update_multi). Each
+kernel is compiled for its instruction set with a target attribute
+and hash_cpu picks them at run time, so one binary still runs on any
+x86-64. All give the same digests as the portable block functions;
+DITT_HASH=portable in the environment forces the portable ones.
+*****************************************************************/
+# if defined(__x86_64__) && defined(__GNUC__) && __GNUC__ >= 5
+# define HASH_X86
+# include <immintrin.h>
+# include <cpuid.h>
+
+# define XMM(p)		_mm_loadu_si128 ((const __m128i *) (p))
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_ni (unsigned int *s, unsigned char *b, size_t n)
+{
+	__m128i		abcd,
+			abcd0,
+			e0,
+			e1,
+			e_0,
+			w[4];
+	const __m128i	swap = _mm_set_epi64x (0x0001020304050607ULL,
+				0x08090a0b0c0d0e0fULL);
+	int		i;
+
+	abcd = _mm_shuffle_epi32 (XMM(s),0x1b);
+	e0 = _mm_set_epi32 (s[4],0,0,0);
+	for (; n; n--, b += 64) {
+		abcd0 = abcd;
+		e_0 = e0;
+# pragma GCC unroll 20	/* so the round function is a constant */
+		for (i = 0; i < 20; i++) { /* four rounds a time */
+			if (i < 4) w[i] = _mm_shuffle_epi8 (XMM(b + 16*i),swap);
+			if (i == 0) e0 = _mm_add_epi32 (e0,w[0]);
+			else if (i & 1) e1 = _mm_sha1nexte_epu32 (e1,w[i&3]);
+			else e0 = _mm_sha1nexte_epu32 (e0,w[i&3]);
+			if (i & 1) e0 = abcd;
+			else e1 = abcd;
+			if (i >= 3 && i <= 18)
+				w[(i+1)&3] = _mm_sha1msg2_epu32 (w[(i+1)&3],w[i&3]);
+			switch (i/5) { /* the round function is an immediate */
+			case 0: abcd = _mm_sha1rnds4_epu32 (abcd,i & 1 ? e1 : e0,0); break;
+			case 1: abcd = _mm_sha1rnds4_epu32 (abcd,i & 1 ? e1 : e0,1); break;
+			case 2: abcd = _mm_sha1rnds4_epu32 (abcd,i & 1 ? e1 : e0,2); break;
+			default: abcd = _mm_sha1rnds4_epu32 (abcd,i & 1 ? e1 : e0,3);
+			}
+			if (i >= 1 && i <= 16)
+				w[(i-1)&3] = _mm_sha1msg1_epu32 (w[(i-1)&3],w[i&3]);
+			if (i >= 2 && i <= 17)
+				w[(i-2)&3] = _mm_xor_si128 (w[(i-2)&3],w[i&3]);
+		}
+		e0 = _mm_sha1nexte_epu32 (e0,e_0);
+		abcd = _mm_add_epi32 (abcd,abcd0);
+	}
+	_mm_storeu_si128 ((__m128i *) s,_mm_shuffle_epi32 (abcd,0x1b));
+	s[4] = _mm_extract_epi32 (e0,3);
+}
+
+__attribute__((target("sha,sse4.1")))
+static void sha256_ni (unsigned int *s, unsigned char *b, size_t n)
+{
+	__m128i		s0,
+			s1,
+			abef,
+			cdgh,
+			m,
+			t,
+			w[4];
+	const __m128i	swap = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+				0x0405060700010203ULL);
+	int		i;
+
+	t = _mm_shuffle_epi32 (XMM(s),0xb1);	/* CDAB */
+	s1 = _mm_shuffle_epi32 (XMM(s + 4),0x1b); /* EFGH */
+	s0 = _mm_alignr_epi8 (t,s1,8);		/* ABEF */
+	s1 = _mm_blend_epi16 (s1,t,0xf0);	/* CDGH */
+	for (; n; n--, b += 64) {
+		abef = s0;
+		cdgh = s1;
+# pragma GCC unroll 16
+		for (i = 0; i < 16; i++) { /* four rounds a time */
+			if (i < 4) w[i] = _mm_shuffle_epi8 (XMM(b + 16*i),swap);
+			m = _mm_add_epi32 (w[i&3],XMM(sha256_k + 4*i));
+			s1 = _mm_sha256rnds2_epu32 (s1,s0,m);
+			if (i >= 3 && i <= 14) {
+				t = _mm_alignr_epi8 (w[i&3],w[(i-1)&3],4);
+				w[(i+1)&3] = _mm_add_epi32 (w[(i+1)&3],t);
+				w[(i+1)&3] = _mm_sha256msg2_epu32 (w[(i+1)&3],w[i&3]);
+			}
+			s0 = _mm_sha256rnds2_epu32 (s0,s1,_mm_shuffle_epi32 (m,0x0e));
+			if (i >= 1 && i <= 12)
+				w[(i-1)&3] = _mm_sha256msg1_epu32 (w[(i-1)&3],w[i&3]);
+		}
+		s0 = _mm_add_epi32 (s0,abef);
+		s1 = _mm_add_epi32 (s1,cdgh);
+	}
+	t = _mm_shuffle_epi32 (s0,0x1b);	/* FEBA */
+	s1 = _mm_shuffle_epi32 (s1,0xb1);	/* DCHG */
+	_mm_storeu_si128 ((__m128i *) s,_mm_blend_epi16 (t,s1,0xf0)); /* DCBA */
+	_mm_storeu_si128 ((__m128i *) (s + 4),_mm_alignr_epi8 (s1,t,8)); /* HGFE */
+}
+
+/*****************************************************************
+MD5 of eight messages at once: n blocks at each b[j] into state s[j]
+*****************************************************************/
+__attribute__((target("avx2")))
+static void md5_x8 (unsigned int **s, unsigned char **b, size_t n)
+{
+	__m256i		v[4],
+			v0[4],
+			w[16],
+			f,
+			t;
+	const __m256i	ones = _mm256_set1_epi32 (-1);
+	unsigned int	x[8];
+	size_t		at;
+	int		i,
+			j,
+			g;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 8; j++) x[j] = s[j][i];
+		v[i] = _mm256_loadu_si256 ((__m256i *) x);
+	}
+	for (at = 0; at < 64*n; at += 64) {
+		for (i = 0; i < 16; i++) { /* word i of each lane's block */
+			for (j = 0; j < 8; j++) memcpy (x + j,b[j] + at + 4*i,4);
+			w[i] = _mm256_loadu_si256 ((__m256i *) x);
+		}
+		for (i = 0; i < 4; i++) v0[i] = v[i];
+# pragma GCC unroll 64
+		for (i = 0; i < 64; i++) { /* v is a, b, c, d */
+			if (i < 16) {
+				f = _mm256_xor_si256 (v[3],_mm256_and_si256 (v[1],
+					_mm256_xor_si256 (v[2],v[3])));
+				g = i;
+			} else if (i < 32) {
+				f = _mm256_xor_si256 (v[2],_mm256_and_si256 (v[3],
+					_mm256_xor_si256 (v[1],v[2])));
+				g = (5*i + 1) & 15;
+			} else if (i < 48) {
+				f = _mm256_xor_si256 (_mm256_xor_si256 (v[1],v[2]),v[3]);
+				g = (3*i + 5) & 15;
+			} else {
+				f = _mm256_xor_si256 (v[2],_mm256_or_si256 (v[1],
+					_mm256_xor_si256 (v[3],ones)));
+				g = (7*i) & 15;
+			}
+			t = _mm256_add_epi32 (_mm256_add_epi32 (v[0],f),
+				_mm256_add_epi32 (w[g],_mm256_set1_epi32 (md5_k[i])));
+			t = _mm256_or_si256 (
+				_mm256_sll_epi32 (t,_mm_cvtsi32_si128 (md5_r[i])),
+				_mm256_srl_epi32 (t,_mm_cvtsi32_si128 (32 - md5_r[i])));
+			v[0] = v[3];
+			v[3] = v[2];
+			v[2] = v[1];
+			v[1] = _mm256_add_epi32 (v[1],t);
+		}
+		for (i = 0; i < 4; i++) v[i] = _mm256_add_epi32 (v[i],v0[i]);
+	}
+	for (i = 0; i < 4; i++) {
+		_mm256_storeu_si256 ((__m256i *) x,v[i]);
+		for (j = 0; j < 8; j++) s[j][i] = x[j];
+	}
+}
+# endif
+
+/*****************************************************************
+Block functions in use, picked once by hash_cpu
+*****************************************************************/
+static void	(*block_fn[HASH_N])(unsigned int *, unsigned char *, size_t) =
+			{md5_blocks,sha1_blocks,sha256_blocks};
+static int	lanes[HASH_N] = {1,1,1}; /* messages hash_update_multi does at once */
+static char	kernels[NAME_LENGTH] = "portable";
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+static void hash_cpu (void)
+{
+# ifdef HASH_X86
+	unsigned int	a,
+			b,
+			c,
+			d,
+			lo,
+			hi;
+	int		sse = 0,
+			sha = 0,
+			avx2 = 0;
+	char		*e = getenv ("DITT_HASH");
+
+	if (e && strcmp (e,"portable") == 0) return;
+	if (__get_cpuid (1,&a,&b,&c,&d)) {
+		sse = (c >> 9 & 1) && (c >> 19 & 1); /* SSSE3, SSE4.1 */
+		if (c >> 27 & 1) { /* OSXSAVE: may ask which registers the OS saves */
+			__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+			avx2 = (lo & 6) == 6; /* XMM and YMM state */
+		}
+	}
+	if (__get_cpuid_max (0,NULL) >= 7) {
+		__cpuid_count (7,0,a,b,c,d);
+		sha = sse && (b >> 29 & 1);
+		avx2 = avx2 && (b >> 5 & 1);
+	} else avx2 = 0;
+	kernels[0] = '\0';
+	if (sha) {
+		block_fn[HASH_SHA1] = sha1_ni;
+		block_fn[HASH_SHA256] = sha256_ni;
+		strcat (kernels,"SHA-NI SHA1 SHA256");
+	}
+	if (avx2) {
+		lanes[HASH_MD5] = 8;
+		strcat (kernels,sha ? ", AVX2 MD5 x8" : "AVX2 MD5 x8");
+	}
+	if (!kernels[0]) strcpy (kernels,"portable");
+# endif
+}
+
+/*****************************************************************
+Describe the hash kernels in use, for the log
+*****************************************************************/
+char *hash_kernels (void)
+{
+	pthread_once (&cpu_once,hash_cpu);
+	return kernels;
+}
+
+/*****************************************************************
+Number of messages hash_update_multi hashes at once with alg
+(1 if it can only do one message at a time)
+*****************************************************************/
+int hash_lanes (int alg)
+{
+	pthread_once (&cpu_once,hash_cpu);
+	return lanes[alg];
+}
+
+/*****************************************************************
+Run the block function of h's algorithm over n blocks at b
+*****************************************************************/
+static void hash_blocks (hash_ctx *h, unsigned char *b, size_t n)
+{
+	if (n) block_fn[h->alg] (h->state,b,n);
+}
+
+/*****************************************************************
+Start a digest with algorithm alg
+*****************************************************************/
+void hash_init (hash_ctx *h, int alg)
+{
+	static const unsigned int iv[HASH_N][8] = {
+		{0x67452301,0xefcdab89,0x98badcfe,0x10325476},
+		{0x67452301,0xefcdab89,0x98badcfe,0x10325476,0xc3d2e1f0},
+		{0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,
+		 0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19}};
+
+	pthread_once (&cpu_once,hash_cpu);
+	h->alg = alg;
+	h->length = 0;
+	h->n = 0;
+	memcpy (h->state,iv[alg],sizeof(h->state));
+}
+
+/*****************************************************************
+Add len bytes at b to the digest
+*****************************************************************/
+void hash_update (hash_ctx *h, unsigned char *b, size_t len)
+{
+	size_t	k;
+
+	h->length += len;
+	if (h->n) { /* top up the partial block first */
+		k = 64 - h->n;
+		if (k > len) k = len;
+		memcpy (h->block + h->n,b,k);
+		h->n += k;
+		b += k;
+		len -= k;
+		if (h->n < 64) return;
+		hash_blocks (h,h->block,1);
+		h->n = 0;
+	}
+	hash_blocks (h,b,len/64);
+	b += len & ~(size_t) 63;
+	h->n = len & 63;
+	memcpy (h->block,b,h->n);
+}
+
+/*****************************************************************
+Add len bytes to each of n digests, from b[i] to h[i]. The digests
+must all use one algorithm and have hashed the same number of bytes
+so far (mod 64), as leaves of a tree hash have; with hash_lanes(alg)
+above 1 they are hashed hash_lanes at a time by one kernel.
+*****************************************************************/
+void hash_update_multi (hash_ctx **h, unsigned char **b, size_t len, int n)
+{
+	unsigned int	*s[HASH_LANES],
+			spare[4];
+	unsigned char	*p[HASH_LANES];
+	size_t		k = 0,
+			blocks;
+	int		i,
+			j;
+
+	for (i = 1; i < n; i++)
+		if (h[i]->alg != h[0]->alg || h[i]->n != h[0]->n) break;
+	if (n < 2 || i < n || hash_lanes (h[0]->alg) == 1) {
+		for (i = 0; i < n; i++) hash_update (h[i],b[i],len);
+		return;
+	}
+	if (h[0]->n) { /* top up the partial blocks */
+		k = 64 - h[0]->n;
+		if (k > len) k = len;
+		for (i = 0; i < n; i++) hash_update (h[i],b[i],k);
+	}
+	blocks = (len - k)/64;
+# ifdef HASH_X86
+	for (i = 0; i < n; i += HASH_LANES) {
+		for (j = 0; j < HASH_LANES; j++) { /* lanes past n hash lane 0 again */
+			s[j] = i + j < n ? h[i+j]->state : spare;
+			p[j] = b[i + j < n ? i + j : i] + k;
+		}
+		md5_x8 (s,p,blocks);
+	}
+# endif
+	for (i = 0; i < n; i++) {
+		h[i]->length += 64*blocks;
+		hash_update (h[i],b[i] + k + 64*blocks,len - k - 64*blocks);
+	}
+}
+
+/*****************************************************************
+Finish the digest and put it in out (hash_size(alg) bytes)
+*****************************************************************/
+void hash_final (hash_ctx *h, unsigned char *out)
+{
+	unsigned long long	bits = h->length*8;
+	int			i;
+
+	h->block[h->n++] = 0x80;
+	if (h->n > 56) {
+		memset (h->block + h->n,0,64 - h->n);
+		hash_blocks (h,h->block,1);
+		h->n = 0;
+	}
+	memset (h->block + h->n,0,56 - h->n);
+	for (i = 0; i < 8; i++) /* MD5 puts the length little endian */
+		h->block[h->alg == HASH_MD5 ? 56 + i : 63 - i] = bits >> (8*i);
+	hash_blocks (h,h->block,1);
+	for (i = 0; i < sizes[h->alg]; i++)
+		out[i] = h->alg == HASH_MD5 ? h->state[i/4] >> (8*(i%4)) :
+			h->state[i/4] >> (8*(3 - i%4));
+}
+
+int hash_size (int alg)
+{
+	return sizes[alg];
+}
+
+char *hash_name (int alg)
+{
+	return names[alg];
+}
+
+/*****************************************************************
+Algorithm named s (MD5, sha1, sha256sum, ...) or -1
+*****************************************************************/
+int hash_lookup (char *s)
+{
+	int	i,
+		n;
+
+	for (i = 0; i < HASH_N; i++) {
+		n = strlen (names[i]);
+		if (strncasecmp (s,names[i],n) == 0
+				&& (s[n] == '\0' || strcmp (s + n,"sum") == 0))
+			return i;
+	}
+	return -1;
+}
+
+/*****************************************************************
+Digest d of n bytes as upper case hex in s (2n+1 bytes)
+*****************************************************************/
+char *hash_hex (unsigned char *d, int n, char *s)
+{
+	int	i;
+
+	for (i = 0; i < n; i++) sprintf (s + 2*i,"%02X",d[i]);
+	s[2*n] = '\0';
+	return s;
+}
+
+/*****************************************************************
+Segment manifests (see hash_manifest in zhash.h)
+*****************************************************************/
+
+/*****************************************************************
+Make an empty manifest for n sectors of dev from lba first in
+segments of seg sectors, with digest alg
+*****************************************************************/
+hash_manifest_ptr manifest_create (char *dev, int alg, off_t first, off_t n,
+	off_t seg)
+{
+	hash_manifest_ptr	m;
+
+	m = (hash_manifest_ptr) calloc (1,sizeof(hash_manifest));
+	if (m == NULL) return NULL;
+	strncpy (m->dev,dev,NAME_LENGTH - 1);
+	m->alg = alg;
+	m->first = first;
+	m->n_sectors = n;
+	m->seg = seg;
+	m->n_segs = (n + seg - 1)/seg;
+	m->digest = (unsigned char *) calloc (m->n_segs + 1,hash_size(alg));
+	if (m->digest == NULL) {
+		free (m);
+		return NULL;
+	}
+	hash_init (&m->ctx,alg);
+	return m;
+}
+
+/*****************************************************************
+Add sectors lo through hi (at b) to the manifest's segments; called
+by the digest thread of the manifest's algorithm, in order
+*****************************************************************/
+static void manifest_update (hash_manifest_ptr m, unsigned char *b,
+	off_t lo, off_t hi)
+{
+	off_t	end;
+
+	if (lo < m->first) {
+		b += (m->first - lo)*BYTES_PER_SECTOR;
+		lo = m->first;
+	}
+	if (hi > m->first + m->n_sectors - 1) hi = m->first + m->n_sectors - 1;
+	while (lo <= hi && m->at < m->n_segs) {
+		end = seg_first(m,m->at) + seg_length(m,m->at) - 1;
+		if (end > hi) {
+			hash_update (&m->ctx,b,(hi - lo + 1)*BYTES_PER_SECTOR);
+			return;
+		}
+		hash_update (&m->ctx,b,(end - lo + 1)*BYTES_PER_SECTOR);
+		hash_final (&m->ctx,seg_digest(m,m->at));
+		hash_init (&m->ctx,m->alg);
+		m->at++;
+		b += (end - lo + 1)*BYTES_PER_SECTOR;
+		lo = end + 1;
+	}
+}
+
+/*****************************************************************
+Write manifest m to f
+*****************************************************************/
+void manifest_write (FILE *f, hash_manifest_ptr m)
+{
+	char	hex[2*HASH_MAX_SIZE + 1];
+	int	i;
+
+	fprintf (f,"# DITT segment manifest\n");
+	fprintf (f,"device %s\n",m->dev);
+	fprintf (f,"first %llu\n",m->first);
+	fprintf (f,"sectors %llu\n",m->n_sectors);
+	fprintf (f,"segment %llu\n",m->seg);
+	fprintf (f,"hash %s\n",hash_name(m->alg));
+	fprintf (f,"total %s\n",hash_hex (m->total,hash_size(m->alg),hex));
+	if (m->tree_leaf) fprintf (f,"tree %llu %s\n",m->tree_leaf,
+		hash_hex (m->tree_root,hash_size(m->alg),hex));
+	fprintf (f,"segments %d\n",m->n_segs);
+	for (i = 0; i < m->n_segs; i++)
+		fprintf (f,"%d %llu %s\n",i,seg_first(m,i),
+			hash_hex (seg_digest(m,i),hash_size(m->alg),hex));
+}
+
+/*****************************************************************
+Convert hex string s to n bytes at d
+	returns 0 if s is exactly 2n hex digits
+*****************************************************************/
+static int from_hex (char *s, unsigned char *d, int n)
+{
+	unsigned int	x;
+	int		i;
+
+	if (strlen (s) != 2*n) return 1;
+	for (i = 0; i < n; i++) {
+		if (sscanf (s + 2*i,"%2x",&x) != 1) return 1;
+		d[i] = x;
+	}
+	return 0;
+}
+
+/*****************************************************************
+Read a manifest written by manifest_write
+	returns NULL if f is not a manifest
+*****************************************************************/
+hash_manifest_ptr manifest_read (FILE *f)
+{
+	hash_manifest_ptr	m;
+	char			line[256],
+				dev[NAME_LENGTH] = "",
+				name[16],
+				hex[2*HASH_MAX_SIZE + 2];
+	unsigned char		total[HASH_MAX_SIZE],
+				root[HASH_MAX_SIZE];
+	off_t			first,
+				n,
+				seg,
+				lba,
+				leaf = 0;
+	int			alg,
+				n_segs,
+				i,
+				ix;
+
+	if (fgets (line,sizeof(line),f) == NULL
+		|| strncmp (line,"# DITT segment manifest",23)) return NULL;
+	if (fscanf (f," device %79s",dev) != 1
+		|| fscanf (f," first %llu",&first) != 1
+		|| fscanf (f," sectors %llu",&n) != 1
+		|| fscanf (f," segment %llu",&seg) != 1 || seg <= 0
+		|| fscanf (f," hash %15s",name) != 1
+		|| (alg = hash_lookup (name)) < 0
+		|| fscanf (f," total %65s",hex) != 1
+		|| from_hex (hex,total,hash_size(alg))
+		|| fscanf (f," %15s",name) != 1) return NULL;
+	if (strcmp (name,"tree") == 0) { /* optional tree root */
+		if (fscanf (f," %llu %65s",&leaf,hex) != 2 || leaf <= 0
+				|| from_hex (hex,root,hash_size(alg))
+				|| fscanf (f," %15s",name) != 1) return NULL;
+	}
+	if (strcmp (name,"segments") || fscanf (f," %d",&n_segs) != 1) return NULL;
+	m = manifest_create (dev,alg,first,n,seg);
+	if (m == NULL || m->n_segs != n_segs) return NULL;
+	memcpy (m->total,total,sizeof(total));
+	m->tree_leaf = leaf;
+	if (leaf) memcpy (m->tree_root,root,sizeof(root));
+	for (i = 0; i < n_segs; i++)
+		if (fscanf (f," %d %llu %65s",&ix,&lba,hex) != 3 || ix != i
+				|| lba != seg_first(m,i)
+				|| from_hex (hex,seg_digest(m,i),hash_size(alg))) {
+			free (m->digest);
+			free (m);
+			return NULL;
+		}
+	m->at = n_segs;
+	return m;
+}
+
+/*****************************************************************
+Tree hashing (see hash_tree in zhash.h)
+*****************************************************************/
+
+/*****************************************************************
+Make a tree for n sectors from lba first, leaves of leaf sectors,
+hashed with alg by n_threads threads
+*****************************************************************/
+hash_tree_ptr tree_create (int alg, off_t first, off_t n, off_t leaf,
+	int n_threads)
+{
+	hash_tree_ptr	t;
+
+	t = (hash_tree_ptr) calloc (1,sizeof(hash_tree));
+	if (t == NULL) return NULL;
+	t->alg = alg;
+	t->first = first;
+	t->n_sectors = n;
+	t->leaf = leaf;
+	t->n_threads = n_threads < 1 ? 1 :
+		n_threads > TREE_MAX_THREADS ? TREE_MAX_THREADS : n_threads;
+	t->n_leaves = (n + leaf - 1)/leaf;
+	t->digest = (unsigned char *) malloc ((t->n_leaves + 1)*hash_size(alg));
+	if (t->digest == NULL) {
+		free (t);
+		return NULL;
+	}
+	return t;
+}
+
+/*****************************************************************
+Combine the leaf digests of t into its root. The digests are
+replaced level by level, so this is done once.
+*****************************************************************/
+static void tree_root (hash_tree_ptr t)
+{
+	hash_ctx	h;
+	unsigned char	node = 0x01;
+	int		size = hash_size(t->alg);
+	long		n = t->n_leaves,
+			i;
+
+	while (n > 1) {
+		for (i = 0; i + 1 < n; i += 2) {
+			hash_init (&h,t->alg);
+			hash_update (&h,&node,1);
+			hash_update (&h,t->digest + i*size,2*size);
+			hash_final (&h,t->digest + (i/2)*size);
+		}
+		if (n & 1) memmove (t->digest + (n/2)*size,t->digest + (n - 1)*size,size);
+		n = (n + 1)/2;
+	}
+	memcpy (t->root,t->digest,size);
+}
+
+/*****************************************************************
+Disk hashing (see hash_range in zhash.h)
+The reader (the calling thread) fills the buffers in order; buffer
+j goes in slot j % HASH_BUFFERS. Each digest thread takes the
+buffers in the same order and adds the part of each buffer that
+falls in a range to that range's digest. A slot is refilled once
+all of the digest threads have released it.
+*****************************************************************/
+typedef struct {
+	unsigned char	*buf[HASH_BUFFERS];
+	off_t		lba[HASH_BUFFERS], /* first sector in each buffer */
+			n[HASH_BUFFERS]; /* sectors in each buffer */
+	int		busy[HASH_BUFFERS], /* digest threads still using it */
+			n_algs;
+	long		n_filled; /* buffers filled so far */
+	int		eof;	/* no more buffers */
+	hash_range_ptr	r;	/* the ranges */
+	int		n_ranges;
+	hash_tree_ptr	tree;	/* leaves hashed by the tree threads (or NULL) */
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+} hash_ring;
+
+typedef struct {
+	hash_ring	*ring;
+	int		alg;
+	pthread_t	thread;
+} hash_worker;
+
+static void *hash_thread (void *arg)
+{
+	hash_worker	*w = (hash_worker *) arg;
+	hash_ring	*ring = w->ring;
+	hash_range_ptr	r;
+	off_t		lo,
+			hi,
+			end;
+	long		j;
+	int		slot,
+			i;
+
+	for (j = 0; ; j++) {
+		slot = j % HASH_BUFFERS;
+		pthread_mutex_lock (&ring->lock);
+		while (j >= ring->n_filled && !ring->eof)
+			pthread_cond_wait (&ring->wake,&ring->lock);
+		pthread_mutex_unlock (&ring->lock);
+		if (j >= ring->n_filled) break; /* done */
+		end = ring->lba[slot] + ring->n[slot] - 1;
+		for (i = 0; i < ring->n_ranges; i++) {
+			r = &ring->r[i];
+			if (r->first > end) break; /* sorted: no more in this buffer */
+			lo = r->first > ring->lba[slot] ? r->first : ring->lba[slot];
+			hi = r->last < end ? r->last : end;
+			if (lo > hi) continue;
+			hash_update (&r->ctx[w->alg],
+				ring->buf[slot] + (lo - ring->lba[slot])*BYTES_PER_SECTOR,
+				(hi - lo + 1)*BYTES_PER_SECTOR);
+			if (r->manifest && r->manifest->alg == w->alg)
+				manifest_update (r->manifest,
+					ring->buf[slot] + (lo - ring->lba[slot])*BYTES_PER_SECTOR,
+					lo,hi);
+		}
+		pthread_mutex_lock (&ring->lock);
+		if (--ring->busy[slot] == 0) pthread_cond_broadcast (&ring->wake);
+		pthread_mutex_unlock (&ring->lock);
+	}
+	return NULL;
+}
+
+/*****************************************************************
+Tree thread body: hash the next leaves not yet taken until none are
+left. Leaf j is in the buffer j/(HASH_BLOCK/leaf) read since the
+tree's range holds every range read. Leaves are taken hash_lanes(alg) at a
+time and those in the same buffer hashed together (hash_update_multi).
+*****************************************************************/
+static void *tree_thread (void *arg)
+{
+	hash_ring	*ring = (hash_ring *) arg;
+	hash_tree_ptr	t = ring->tree;
+	hash_ctx	h[HASH_LANES],
+			*hp[HASH_LANES];
+	unsigned char	leaf = 0x00,
+			*lb[HASH_LANES];
+	off_t		per_buffer = HASH_BLOCK/t->leaf,
+			k;
+	long		j,
+			e,
+			last,
+			b;
+	int		slot,
+			take = hash_lanes (t->alg),
+			short_leaf,
+			n,
+			i;
+
+	if (take > per_buffer) take = per_buffer;
+	while ((j = __sync_fetch_and_add (&t->next,take)) < t->n_leaves) {
+		last = j + take < t->n_leaves ? j + take : t->n_leaves;
+		for (; j < last; j = e) { /* leaves j to e - 1 are in buffer b */
+			b = j/per_buffer;
+			e = (b + 1)*per_buffer < last ? (b + 1)*per_buffer : last;
+			slot = b % HASH_BUFFERS;
+			pthread_mutex_lock (&ring->lock);
+			while (b >= ring->n_filled && !ring->eof)
+				pthread_cond_wait (&ring->wake,&ring->lock);
+			pthread_mutex_unlock (&ring->lock);
+			if (b >= ring->n_filled) return NULL; /* reading stopped */
+			n = e - j;
+			for (i = 0; i < n; i++) {
+				hp[i] = h + i;
+				lb[i] = ring->buf[slot]
+					+ ((j + i) % per_buffer)*t->leaf*BYTES_PER_SECTOR;
+				hash_init (hp[i],t->alg);
+				hash_update (hp[i],&leaf,1);
+			}
+			k = ring->n[slot] - ((e - 1) % per_buffer)*t->leaf;
+			short_leaf = k < t->leaf; /* only the last leaf of all */
+			if (short_leaf) hash_update (hp[n-1],lb[n-1],k*BYTES_PER_SECTOR);
+			hash_update_multi (hp,lb,t->leaf*BYTES_PER_SECTOR,n - short_leaf);
+			for (i = 0; i < n; i++)
+				hash_final (hp[i],t->digest + (j + i)*hash_size(t->alg));
+			pthread_mutex_lock (&ring->lock);
+			if ((ring->busy[slot] -= n) == 0) pthread_cond_broadcast (&ring->wake);
+			pthread_mutex_unlock (&ring->lock);
+		}
+	}
+	return NULL;
+}
+
+/*****************************************************************
+Add partition at (length sectors from first) to the n ranges at r
+*****************************************************************/
+static int add_partition (hash_range_ptr r, int *n, int max, off_t first,
+	off_t length, int at, int type)
+{
+	if (*n >= max) return 1;
+	memset (r + *n,0,sizeof(*r));
+	r[*n].first = first;
+	r[*n].last = first + length - 1;
+	sprintf (r[*n].label,"partition %d type %02X",at,type);
+	(*n)++;
+	return 0;
+}
+
+/*****************************************************************
+Add a range for each partition of disk d to the n ranges at r (at
+most max). Partitions are numbered as partab and partcmp number
+them; empty entries and extended partitions are left out.
+	returns 0, or 1 if the table can not be read or there are
+	too many ranges
+*****************************************************************/
+int hash_partition_ranges (disk_control_ptr d, hash_range_ptr r, int *n, int max)
+{
+	pte_rec		p[4];
+	pte_ptr		sub;
+	off_t		pt_base;
+	int		at = 1,
+			i;
+
+	if (get_partition_table (d,p)) return 1;
+	for (i = 0; i < 4; i++, at++) {
+		if (p[i].type && !is_extended(p[i].type) && p[i].lba_length
+				&& add_partition (r,n,max,p[i].lba_start,p[i].lba_length,at,p[i].type))
+			return 1;
+		pt_base = p[i].lba_start;
+		for (sub = p[i].next; sub; sub = sub->next) {
+			at++;
+			if (is_extended(sub->type))
+				pt_base = p[i].lba_start + sub->lba_start;
+			else if (sub->type && sub->lba_length
+					&& add_partition (r,n,max,pt_base + sub->lba_start,
+					sub->lba_length,at,sub->type))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+static int by_first (const void *a, const void *b)
+{
+	hash_range_ptr	x = (hash_range_ptr) a,
+			y = (hash_range_ptr) b;
+
+	if (x->first != y->first) return x->first < y->first ? -1 : 1;
+	return x->last < y->last ? -1 : x->last > y->last;
+}
+
+/*****************************************************************
+Sort n ranges by first sector
+	returns the number of sectors hash_ranges will read (ranges
+	that overlap are read once)
+*****************************************************************/
+off_t hash_sort_ranges (hash_range_ptr r, int n)
+{
+	off_t	total = 0,
+		end = 0; /* one past the last sector counted so far */
+	int	i;
+
+	qsort (r,n,sizeof(*r),by_first);
+	for (i = 0; i < n; i++) {
+		if (r[i].last < end) continue;
+		total += r[i].last + 1 - (r[i].first > end ? r[i].first : end);
+		end = r[i].last + 1;
+	}
+	return total;
+}
+
+/*****************************************************************
+Hash ranges of disk d in one pass, lowest sector first
+	r -- n ranges sorted by hash_sort_ranges; each gets digests
+		for the algorithms in algs and its count of bad sectors
+	error -- gets ranges of sectors that could not be read (or NULL)
+	n_read -- gets the number of sectors read
+	progress -- counts sectors read (or NULL)
+	returns 0, or 1 if out of memory or threads
+*****************************************************************/
+int hash_ranges (disk_control_ptr d, hash_range_ptr r, int n, int algs,
+	range_ptr error, off_t *n_read, progress_ptr progress)
+{
+	hash_ring	ring;
+	hash_worker	w[HASH_N];
+	pthread_t	tt[TREE_MAX_THREADS];
+	off_t		s,
+			k,
+			j,
+			end,
+			next = 0; /* first sector not read yet */
+	long		b = 0;
+	int		i,
+			m,
+			slot,
+			n_tree = 0,
+			status = 0;
+
+	memset (&ring,0,sizeof(ring));
+	ring.r = r;
+	ring.n_ranges = n;
+	for (i = 0; i < n; i++) if (r[i].tree) ring.tree = r[i].tree;
+	for (i = 0; ring.tree && i < n; i++) /* reading must start at the tree */
+		if (r[i].first < ring.tree->first
+				|| r[i].last >= ring.tree->first + ring.tree->n_sectors)
+			ring.tree = NULL;
+	if (ring.tree) ring.tree->next = 0;
+	*n_read = 0;
+	for (i = 0; i < HASH_BUFFERS; i++)
+		if (posix_memalign ((void **) &ring.buf[i],4096,HASH_BLOCK*BYTES_PER_SECTOR)) {
+			while (i--) free (ring.buf[i]);
+			return 1;
+		}
+	for (i = 0; i < n; i++) {
+		r[i].n_error = 0;
+		for (m = 0; m < HASH_N; m++) hash_init (&r[i].ctx[m],m);
+	}
+	pthread_mutex_init (&ring.lock,NULL);
+	pthread_cond_init (&ring.wake,NULL);
+	for (m = 0; m < HASH_N; m++) {
+		if (!(algs & (1 << m))) continue;
+		w[m].ring = &ring;
+		w[m].alg = m;
+		if (pthread_create (&w[m].thread,NULL,hash_thread,&w[m])) {
+			status = 1;
+			algs &= ~(1 << m);
+		} else ring.n_algs++;
+	}
+	if (ring.tree) {
+		for (i = 0; i < ring.tree->n_threads; i++)
+			if (pthread_create (&tt[n_tree],NULL,tree_thread,&ring) == 0) n_tree++;
+		if (!n_tree) status = 1;
+	}
+
+	for (i = 0; !status && i < n; i++) {
+		if (r[i].last < next) continue; /* already read */
+		s = r[i].first > next ? r[i].first : next;
+		/* read through to the end of this run of overlapping ranges */
+		for (end = r[i].last; i + 1 < n && r[i+1].first <= end + 1; i++)
+			if (r[i+1].last > end) end = r[i+1].last;
+		posix_fadvise (d->fd,s*BYTES_PER_SECTOR,(end + 1 - s)*BYTES_PER_SECTOR,
+			POSIX_FADV_SEQUENTIAL);
+		for (; s <= end; s += k, b++) {
+			k = HASH_BLOCK;
+			if (s + k > end + 1) k = end + 1 - s;
+			slot = b % HASH_BUFFERS;
+			pthread_mutex_lock (&ring.lock);
+			while (ring.busy[slot]) pthread_cond_wait (&ring.wake,&ring.lock);
+			pthread_mutex_unlock (&ring.lock);
+			if (read_sectors (d,s,k,ring.buf[slot])) {
+				/* take it a sector at a time, bad ones are hashed as zeroes */
+				for (j = 0; j < k; j++)
+					if (read_sectors (d,s + j,1,ring.buf[slot] + j*BYTES_PER_SECTOR)) {
+						memset (ring.buf[slot] + j*BYTES_PER_SECTOR,0,BYTES_PER_SECTOR);
+						if (error) add_to_range (error,s + j);
+						for (m = 0; m < n; m++)
+							if (r[m].first <= s + j && s + j <= r[m].last)
+								r[m].n_error++;
+					}
+			}
+			ring.lba[slot] = s;
+			ring.n[slot] = k;
+			pthread_mutex_lock (&ring.lock);
+			ring.busy[slot] = ring.n_algs;
+			if (ring.tree) /* and one for each leaf in it */
+				ring.busy[slot] += (k + ring.tree->leaf - 1)/ring.tree->leaf;
+			ring.n_filled++;
+			pthread_cond_broadcast (&ring.wake);
+			pthread_mutex_unlock (&ring.lock);
+			*n_read += k;
+			if (progress) progress_add (progress,k);
+		}
+		next = end + 1;
+	}
+
+	pthread_mutex_lock (&ring.lock);
+	ring.eof = 1;
+	pthread_cond_broadcast (&ring.wake);
+	pthread_mutex_unlock (&ring.lock);
+	for (m = 0; m < HASH_N; m++) {
+		if (!(algs & (1 << m))) continue;
+		pthread_join (w[m].thread,NULL);
+		for (i = 0; i < n; i++) hash_final (&r[i].ctx[m],r[i].digest[m]);
+	}
+	for (i = 0; i < n_tree; i++) pthread_join (tt[i],NULL);
+	if (ring.tree && !status) tree_root (ring.tree);
+	for (i = 0; i < n; i++)
+		if (r[i].manifest) memcpy (r[i].manifest->total,
+			r[i].digest[r[i].manifest->alg],HASH_MAX_SIZE);
+	for (i = 0; i < HASH_BUFFERS; i++) free (ring.buf[i]);
+	pthread_mutex_destroy (&ring.lock);
+	pthread_cond_destroy (&ring.wake);
+	return status;
+}
+
+/*****************************************************************
+Hash n sectors of disk d starting at lba "from" (one range)
+	h -- algs set by the caller, gets the digests
+	progress -- counts sectors read (or NULL)
+	returns 0, or 1 if out of memory or threads
+*****************************************************************/
+int hash_disk (disk_control_ptr d, off_t from, off_t n, disk_hash_ptr h,
+	progress_ptr progress)
+{
+	hash_range	r;
+	int		status;
+
+	r.first = from;
+	r.last = from + n - 1;
+	r.manifest = h->manifest;
+	r.tree = h->tree;
+	status = hash_ranges (d,&r,1,h->algs,h->error,&h->n_read,progress);
+	h->n_error = r.n_error;
+	memcpy (h->digest,r.digest,sizeof(h->digest));
+	return status;
+}
@@ -0,0 +1,179 @@
+# define ZH_H_ID "@(#) zhash.h Linux Version 1.0"
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+/* zhash.h needs zbios.h first */
+
+#define HASH_MD5	0
+#define HASH_SHA1	1
+#define HASH_SHA256	2
+#define HASH_N		3	/* number of digest algorithms */
+#define HASH_ALL	((1 << HASH_N) - 1) /* mask of all algorithms */
+#define HASH_MAX_SIZE	32	/* bytes in the longest digest */
+
+#define HASH_BLOCK	8192	/* sectors per read (4 MB) */
+#define HASH_BUFFERS	4	/* read buffers shared by the digest threads */
+#define HASH_LANES	8	/* most messages one kernel hashes at once */
+
+#define SEG_MIN_MB	1	/* manifest segment size limits */
+#define SEG_MAX_MB	64
+#define SEG_MB		16	/* default segment size */
+
+#define TREE_LEAF	2048	/* sectors per tree leaf (1 MB) */
+#define TREE_MIN_KB	64	/* tree leaf size limits (a power of two) */
+#define TREE_MAX_KB	(HASH_BLOCK/2)
+#define TREE_MAX_THREADS 64
+
+/******************************************************************************
+State of one digest computation. MD5, SHA-1 and SHA-256 all work on
+64 byte blocks with at most eight 32 bit words of state.
+******************************************************************************/
+typedef struct {
+	int			alg;	/* HASH_MD5 ... */
+	unsigned long long	length;	/* bytes hashed so far */
+	unsigned int		state[8];
+	unsigned char		block[64]; /* partial block */
+	int			n;	/* bytes in block */
+} hash_ctx;
+
+/******************************************************************************
+Segment manifest: a digest for each segment of seg sectors of a run of
+sectors (the last segment may be short) and the digest of the whole
+run. It is made along with the whole digest when the manifest hangs on
+a hash_range, and kept as a text file (manifest_write, manifest_read):
+	# DITT segment manifest
+	device <name>
+	first <lba>		first sector of segment 0
+	sectors <n>		sectors covered
+	segment <n>		sectors per segment
+	hash <MD5|SHA1|SHA256>
+	total <hex>		digest of all n sectors
+	tree <leaf sectors> <hex>	tree hash root (optional, see hash_tree)
+	segments <n>
+	<index> <first lba> <hex>	one line per segment
+Two manifests with the same layout can be compared segment by segment,
+and a disk or image can be checked against one a segment at a time,
+so a change is found without comparing or hashing the whole disk.
+******************************************************************************/
+typedef struct {
+	char		dev[NAME_LENGTH];
+	int		alg,
+			n_segs,
+			at;	/* next segment to finish */
+	off_t		first,
+			n_sectors,
+			seg;
+	unsigned char	total[HASH_MAX_SIZE],
+			*digest; /* n_segs digests, hash_size(alg) bytes each */
+	hash_ctx	ctx;	/* segment being hashed */
+	off_t		tree_leaf; /* tree hash leaf size, 0 if no tree root */
+	unsigned char	tree_root[HASH_MAX_SIZE];
+} hash_manifest, *hash_manifest_ptr;
+
+/******************************************************************************
+Tree hash: the n_sectors from first are cut into leaves of leaf sectors
+(the last may be short), each leaf is hashed on its own and the leaf
+digests are combined in pairs, level by level, up to a root:
+	leaf	H(0x00 | data)
+	node	H(0x01 | left | right)	(an odd node moves up unchanged)
+Leaves are independent, so a pool of n_threads threads hashes them at
+the same time as the linear digests are computed from the same reads
+(see hash_ranges). The root is only comparable with a root made with
+the same algorithm and leaf size.
+******************************************************************************/
+typedef struct {
+	int		alg,
+			n_threads; /* leaf hashing threads */
+	off_t		first,
+			n_sectors,
+			leaf;	/* sectors per leaf (HASH_BLOCK is a multiple) */
+	long		n_leaves;
+	volatile long	next;	/* next leaf to take */
+	unsigned char	*digest, /* n_leaves digests */
+			root[HASH_MAX_SIZE];
+} hash_tree, *hash_tree_ptr;
+
+#define seg_first(m,i)	((m)->first + (off_t) (i)*(m)->seg)
+#define seg_length(m,i)	((i) < (m)->n_segs - 1 ? (m)->seg : \
+			(m)->n_sectors - (off_t) (i)*(m)->seg)
+#define seg_digest(m,i)	((m)->digest + (i)*hash_size((m)->alg))
+#define seg_of(m,s)	((s) < (m)->first || (s) >= (m)->first + (m)->n_sectors ? \
+			-1 : (int) (((s) - (m)->first)/(m)->seg))
+
+/******************************************************************************
+A range of sectors to hash (first through last) with its digests. Any
+number of ranges, in any order and overlapping or not, are hashed in
+one pass over the disk by hash_ranges (see zhash.c).
+******************************************************************************/
+typedef struct {
+	off_t		first,
+			last,
+			n_error; /* sectors that could not be read (hashed as zero) */
+	char		label[NAME_LENGTH]; /* what the range is, for the log */
+	hash_manifest_ptr manifest; /* segment digests wanted (or NULL) */
+	hash_tree_ptr	tree;	/* tree hash wanted (or NULL; its range must
+				   hold every other range) */
+	hash_ctx	ctx[HASH_N];
+	unsigned char	digest[HASH_N][HASH_MAX_SIZE];
+} hash_range, *hash_range_ptr;
+
+/******************************************************************************
+Digests of a run of sectors read from a disk by hash_disk. Each
+algorithm in algs (a mask of 1 << HASH_xxx) has its own thread; the
+reader fills HASH_BUFFERS buffers in turn and each buffer is reused
+once every digest thread is done with it. Sectors that can not be read
+are hashed as zeroes and listed in error.
+******************************************************************************/
+typedef struct {
+	int		algs;	/* digests wanted */
+	unsigned char	digest[HASH_N][HASH_MAX_SIZE];
+	off_t		n_read,	/* sectors hashed */
+			n_error; /* ... of those, sectors that could not be read */
+	range_ptr	error;	/* where they are */
+	hash_manifest_ptr manifest; /* segment digests wanted (or NULL) */
+	hash_tree_ptr	tree;	/* tree hash wanted (or NULL) */
+} disk_hash, *disk_hash_ptr;
+
+/******************************************************************************
+Function decls for zhash.c
+******************************************************************************/
+void		hash_init (hash_ctx *, int);
+void		hash_update (hash_ctx *, unsigned char *, size_t);
+void		hash_update_multi (hash_ctx **, unsigned char **, size_t, int);
+void		hash_final (hash_ctx *, unsigned char *);
+int		hash_size (int);
+char		*hash_name (int);
+int		hash_lookup (char *);
+char		*hash_hex (unsigned char *, int, char *);
+char		*hash_kernels (void);
+int		hash_lanes (int);
+hash_manifest_ptr manifest_create (char *, int, off_t, off_t, off_t);
+void		manifest_write (FILE *, hash_manifest_ptr);
+hash_manifest_ptr manifest_read (FILE *);
+hash_tree_ptr	tree_create (int, off_t, off_t, off_t, int);
+int		hash_partition_ranges (disk_control_ptr, hash_range_ptr, int *, int);
+off_t		hash_sort_ranges (hash_range_ptr, int);
+int		hash_ranges (disk_control_ptr, hash_range_ptr, int, int, range_ptr,
+			off_t *, progress_ptr);
+int		hash_disk (disk_control_ptr, off_t, off_t, disk_hash_ptr, progress_ptr);
@@ -0,0 +1,387 @@
+/******************************************************************************
+The software provided here is released by the National
+Institute of Standards and Technology (NIST), an agency of
+the U.S. Department of Commerce, Gaithersburg MD 20899,
+USA.  The software bears no warranty, either expressed or
+implied. NIST does not assume legal liability nor
+responsibility for a User's use of the software or the
+results of such use.
+
+Please note that within the United States, copyright
+protection, under Section 105 of the United States Code,
+Title 17, is not available for any work of the United
+States Government and/or for any works created by United
+States Government employees. User acknowledges that this
+software contains work which was created by NIST employees
+and is therefore in the public domain and not subject to
+copyright.  The User may use, distribute, or incorporate
+this software provided the User acknowledges this via an
+explicit acknowledgment of NIST-related contributions to
+the User's work. User also agrees to acknowledge, via an
+explicit acknowledgment, that any modifications or
+alterations have been made to this software before
+redistribution.
+******************************************************************************/
+static char *SCCS_ID[] = {"@(#) zoneprof.c Linux Version 1.0",
+			__DATE__,__TIME__};
+static char *test_version = "*** TEST VERSION ";
+# include <features.h>
+# include <unistd.h>
+# include <stdio.h>
+# include "zbios.h"
+# include <time.h>
+# include <string.h>
+# include <malloc.h>
+# include <stdlib.h>
+# include <fcntl.h>
+/*****************************************************************
+Profile the read speed of a disk across its LBA range
+ZONEPROF splits a disk into zones of equal size (the last may be
+short) and reads each zone sequentially, timing every read. Drives
+are slower on the inner tracks (high LBA) and a failing drive often
+shows zones that are much slower than their neighbours long before
+it gives read errors.
+
+For each zone the profile file gets one line:
+	zone first-lba sectors MB/s p50_us p99_us max_us errors
+and the log gets a summary: fastest, slowest and mean zone, the
+ratio of the last zone to the first, zones below the threshold,
+read error ranges and an estimate of the time to read the whole
+disk (e.g., to image it).
+
+The page cache is dropped for each zone before it is read so the
+figures are the drive's, not memory's. With -sample only the
+first part of each zone is read, for a quick profile. With -min_mbs
+the sweep stops at the first zone slower than the threshold.
+
+program outline
+	get command line
+	open the disk
+	for each zone
+		read the zone (or sample) a block at a time, timing each read
+		write the zone's line to the profile
+		stop if below the threshold (-min_mbs)
+	log summary
+*****************************************************************/
+# define PROF_BLOCK	2048	/* sectors per read (1 MB) */
+# define PROF_ZONES	100	/* default number of zones */
+
+typedef struct {
+	off_t		lba,	/* first sector of the zone */
+			n,	/* sectors in the zone */
+			n_read,	/* sectors read (less than n with -sample) */
+			n_error; /* sectors that could not be read */
+	double		secs,	/* time reading the zone */
+			mb_per_sec;
+	unsigned long	p50,	/* read times (usec) */
+			p99,
+			max;
+} zone_rec, *zone_ptr;
+
+static unsigned long long now_usec (void)
+{
+	struct timeval	now;
+
+	gettimeofday (&now,NULL);
+	return (unsigned long long) now.tv_sec*1000000 + now.tv_usec;
+}
+
+static int by_usec (const void *a, const void *b)
+{
+	unsigned long	x = *(unsigned long *) a,
+			y = *(unsigned long *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*****************************************************************
+Read one zone of disk d and time it
+	z -- the zone (lba and n set), gets the results
+	sample -- sectors to read from the start of the zone (0: all)
+	buf -- PROF_BLOCK sectors
+	t -- room for the time of each read
+	error -- read error ranges
+	progress -- counts sectors read
+*****************************************************************/
+void profile_zone (disk_control_ptr d, zone_ptr z, off_t sample,
+	unsigned char *buf, unsigned long *t, range_ptr error,
+	progress_ptr progress)
+{
+	off_t			s,
+				k,
+				j,
+				end,
+				n_t = 0;
+	unsigned long long	t0,
+				start;
+
+	end = z->lba + ((sample && sample < z->n) ? sample : z->n);
+	/* make sure the zone comes from the drive */
+	posix_fadvise (d->fd, z->lba*BYTES_PER_SECTOR,
+		(end - z->lba)*BYTES_PER_SECTOR, POSIX_FADV_DONTNEED);
+	start = now_usec();
+	for (s = z->lba; s < end; s += k) {
+		k = PROF_BLOCK;
+		if (s + k > end) k = end - s;
+		t0 = now_usec();
+		if (read_sectors (d, s, k, buf)) {
+			/* take it a sector at a time to find the bad ones */
+			for (j = 0; j < k; j++)
+				if (read_sectors (d, s + j, 1, buf)) {
+					z->n_error++;
+					add_to_range (error, s + j);
+				}
+		}
+		t[n_t++] = now_usec() - t0;
+		progress_add (progress, k);
+	}
+	z->secs = (now_usec() - start)/1e6;
+	z->n_read = end - z->lba;
+	z->mb_per_sec = z->secs > 0 ?
+		z->n_read*(double) BYTES_PER_SECTOR/(1024*1024)/z->secs : 0;
+	qsort (t, n_t, sizeof(*t), by_usec);
+	z->p50 = n_t ? t[(n_t - 1)/2] : 0;
+	z->p99 = n_t ? t[(n_t*99 + 99)/100 - 1] : 0;
+	z->max = n_t ? t[n_t - 1] : 0;
+	posix_fadvise (d->fd, z->lba*BYTES_PER_SECTOR,
+		(end - z->lba)*BYTES_PER_SECTOR, POSIX_FADV_DONTNEED);
+}
+
+/*****************************************************************
+Print the command line format & options
+	p is the command name
+*****************************************************************/
+void print_help(char *p)
+{
+	static int been_here = 0;
+	if (been_here) return;
+	been_here = 1;
+
+	printf ("Usage: %s test-case host operator drive [-options]\n",p);
+	printf ("-zones nnn\tSplit the disk into nnn zones (default %d)\n",PROF_ZONES);
+	printf ("-zone_mb nnn\tZones of nnn MB (instead of -zones)\n");
+	printf ("-sample nnn\tRead only the first nnn MB of each zone\n");
+	printf ("-min_mbs nnn\tStop at the first zone slower than nnn MB/s\n");
+	printf ("-profile <name>\tProfile file (default is zoneprof.txt)\n");
+	printf ("-comment \" ... \"\tGive a comment on command line\n");
+	printf ("-new_log\tStart a new log file (default is append to old log file)\n");
+	printf ("-log_name <name>\tUse a different log file (default is zoneproflog.txt)\n");
+	printf ("-h\tPrint this option list\n");
+}
+
+main (int np, char **p)
+{
+	char		drive[NAME_LENGTH] = "/dev/hda"; /* default to primary IDE master */
+	int		help = 0,
+			status,
+			i,
+			n_zones = PROF_ZONES,
+			n_done,
+			n_slow = 0,
+			fast = 0,
+			slow = 0;
+	off_t		ns,
+			zone_mb = 0,
+			sample_mb = 0,
+			zone_size,
+			z_lba,
+			n_read = 0,
+			n_error = 0;
+	double		min_mbs = 0,
+			total_secs = 0,
+			est_secs = 0;
+	unsigned long	et;
+	disk_control_ptr d;
+	zone_ptr	z;
+	unsigned char	*buf;
+	unsigned long	*t;
+	range_ptr	error;
+	progress_ptr	progress;
+	static time_t	from;
+	FILE		*log,
+			*prof;
+	char		comment[NAME_LENGTH] = "",
+			log_name[NAME_LENGTH] = "zoneproflog.txt",
+			prof_name[NAME_LENGTH] = "zoneprof.txt",
+			access[2] = "a";
+
+	time(&from);
+	printf ("%s %s%s\n",p[0],ctime(&from),SCCS_ID[0]);
+	printf ("Compiled %s %s with CC Version %s\n",__DATE__,
+		__TIME__,__VERSION__);
+
+	if (np < 5) help = 1;
+	else strncpy(drive, p[4], NAME_LENGTH - 1);
+	for (i = 5; i < np; i++) {
+		if (strcmp (p[i],"-h") == 0) help = 1;
+		else if (strcmp (p[i],"-new_log")== 0) access[0] = 'w';
+		else if (strcmp (p[i],"-comment")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -comment option requires a comment\n",p[0]);
+				help = 1;
+			} else strncpy (comment,p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-log_name")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -log_name option requires a logfile name\n",p[0]);
+				help = 1;
+			} else strncpy(log_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-profile")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -profile option requires a file name\n",p[0]);
+				help = 1;
+			} else strncpy(prof_name, p[i], NAME_LENGTH - 1);
+		}
+		else if (strcmp (p[i],"-zones")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -zones option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%d",&n_zones) != 1 || n_zones <= 0){
+				printf ("%s: invalid -zones value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-zone_mb")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -zone_mb option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%llu",&zone_mb) != 1 || zone_mb <= 0){
+				printf ("%s: invalid -zone_mb value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-sample")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -sample option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%llu",&sample_mb) != 1 || sample_mb <= 0){
+				printf ("%s: invalid -sample value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		}
+		else if (strcmp (p[i],"-min_mbs")== 0){
+			i++;
+			if (i >= np){
+				printf ("%s: -min_mbs option requires a value\n",p[0]);
+				help = 1;
+			} else if (sscanf (p[i],"%lf",&min_mbs) != 1 || min_mbs <= 0){
+				printf ("%s: invalid -min_mbs value %s\n",p[0],p[i]);
+				help = 1;
+			}
+		} else {
+			printf("Invalid parameter: %s\n", p[i]);
+			help = 1;
+		}
+	}
+	if (help) {
+		print_help(p[0]);
+		return 0;
+	}
+	if (SCCS_ID[0][0] == '%') SCCS_ID[0] = test_version;
+	log = log_open(log_name,access,comment,SCCS_ID,np,p);
+
+	d = open_disk (drive,&status);
+	if (status){
+		printf ("%s could not access drive %s status code %d\n",
+			p[0],drive,status);
+		fprintf (log,"%s could not access drive %s status code %d\n",
+			p[0],drive,status);
+		return 1;
+	}
+	log_disk(log,"Profile",d);
+	ns = n_sectors(d);
+
+	/* zone size: a whole number of read blocks */
+	if (zone_mb) zone_size = zone_mb*(1024*1024/BYTES_PER_SECTOR);
+	else zone_size = (ns + n_zones - 1)/n_zones;
+	zone_size = (zone_size + PROF_BLOCK - 1)/PROF_BLOCK*PROF_BLOCK;
+	n_zones = (ns + zone_size - 1)/zone_size;
+	sample_mb *= 1024*1024/BYTES_PER_SECTOR; /* now in sectors */
+	if (sample_mb >= zone_size) sample_mb = 0;
+
+	z = (zone_ptr) calloc (n_zones, sizeof(zone_rec));
+	t = (unsigned long *) malloc ((zone_size/PROF_BLOCK + 1)*sizeof(*t));
+	if (z == NULL || t == NULL
+		|| posix_memalign ((void **) &buf, 4096, PROF_BLOCK*BYTES_PER_SECTOR)) {
+		printf ("Unable to allocate memory!\n");
+		fprintf (log,"Unable to allocate memory!\n");
+		return 1;
+	}
+	prof = fopen (prof_name,"w");
+	if (prof == NULL) {
+		printf ("%s: could not create profile %s\n",p[0],prof_name);
+		fprintf (log,"%s: could not create profile %s\n",p[0],prof_name);
+		return 1;
+	}
+	fprintf (prof,"# %s %s %llu sectors\n",d->dev,d->model_no,ns);
+	fprintf (prof,"# zone first-lba sectors MB/s p50_us p99_us max_us errors\n");
+	fprintf (log,"%d zones of %llu sectors",n_zones,zone_size);
+	if (sample_mb) fprintf (log,", first %llu sectors of each read",sample_mb);
+	fprintf (log,"\n");
+	if (min_mbs > 0) fprintf (log,"Stop below %.1f MB/s\n",min_mbs);
+	error = create_range_list();
+
+	progress = progress_start ("",0,sample_mb ?
+		(off_t) n_zones*sample_mb : ns);
+	for (n_done = 0, z_lba = 0; n_done < n_zones; n_done++, z_lba += zone_size) {
+		z[n_done].lba = z_lba;
+		z[n_done].n = z_lba + zone_size > ns ? ns - z_lba : zone_size;
+		profile_zone (d,&z[n_done],sample_mb,buf,t,error,progress);
+		fprintf (prof,"%d %llu %llu %.1f %lu %lu %lu %llu\n",n_done,
+			z[n_done].lba,z[n_done].n,z[n_done].mb_per_sec,
+			z[n_done].p50,z[n_done].p99,z[n_done].max,z[n_done].n_error);
+		fflush (prof);
+		n_read += z[n_done].n_read;
+		n_error += z[n_done].n_error;
+		total_secs += z[n_done].secs;
+		est_secs += z[n_done].secs*z[n_done].n/z[n_done].n_read;
+		if (z[n_done].mb_per_sec > z[fast].mb_per_sec) fast = n_done;
+		if (z[n_done].mb_per_sec < z[slow].mb_per_sec) slow = n_done;
+		if (min_mbs > 0 && z[n_done].mb_per_sec < min_mbs) {
+			n_slow++;
+			n_done++;
+			break;
+		}
+	}
+	progress_end (progress);
+	fclose (prof);
+
+	fprintf (log,"Profile written to %s\n",prof_name);
+	fprintf (log,"%d of %d zones profiled, %llu sectors read\n",
+		n_done,n_zones,n_read);
+	fprintf (log,"Fastest zone %d (lba %llu) %.1f MB/s\n",fast,z[fast].lba,
+		z[fast].mb_per_sec);
+	fprintf (log,"Slowest zone %d (lba %llu) %.1f MB/s p99 %lu us max %lu us\n",
+		slow,z[slow].lba,z[slow].mb_per_sec,z[slow].p99,z[slow].max);
+	fprintf (log,"Mean %.1f MB/s\n",total_secs > 0 ?
+		n_read*(double) BYTES_PER_SECTOR/(1024*1024)/total_secs : 0.0);
+	if (n_done > 1 && z[0].mb_per_sec > 0)
+		fprintf (log,"Last zone profiled runs at %.0f%% of the first\n",
+			100*z[n_done - 1].mb_per_sec/z[0].mb_per_sec);
+	if (n_done == n_zones) {
+		et = est_secs;
+		fprintf (log,"Estimated time to read the whole disk %lu:%02lu:%02lu\n",
+			et/3600,et/60%60,et%60);
+	}
+	if (n_error) {
+		fprintf (log,"%llu sectors could not be read\n",n_error);
+		print_range_list (log,"Read error range: ",error);
+	}
+	if (n_slow) {
+		fprintf (log,"Stopped at zone %d (lba %llu): %.1f MB/s is below %.1f MB/s\n",
+			n_done - 1,z[n_done - 1].lba,z[n_done - 1].mb_per_sec,min_mbs);
+		printf ("Stopped at zone %d: %.1f MB/s is below %.1f MB/s\n",
+			n_done - 1,z[n_done - 1].mb_per_sec,min_mbs);
+	}
+	printf ("%d zones profiled, slowest %.1f MB/s fastest %.1f MB/s\n",
+		n_done,z[slow].mb_per_sec,z[fast].mb_per_sec);
+	log_close (log,from);
+	return (n_slow || n_error) ? 1 : 0;
+}
@@ -37,16 +37,23 @@ rm output/target/usr/bin/lcd
 output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -I output/staging/usr/include/ -L output/staging/usr/lib -L output/staging/lib -o output/target/usr/bin/lcd ../extraFiles/lcd/lcd.c
 
 #compile ditt files
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/logsetup ../ditt/logsetup.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/adjcmp ../ditt/adjcmp.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/corrpt ../ditt/corrupt.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskchg ../ditt/diskchg.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskcmp ../ditt/diskcmp.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskwipe ../ditt/diskwipe.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/logcase ../ditt/logcase.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/partab ../ditt/partab.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/partcmp ../ditt/partcmp.c
-output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/seccmp ../ditt/seccmp.c
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/logsetup ../ditt/logsetup.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/adjcmp ../ditt/adjcmp.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/corrpt ../ditt/corrupt.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskchg ../ditt/diskchg.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskcmp ../ditt/diskcmp.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskhash ../ditt/diskhash.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -I output/staging/usr/include/ -L output/staging/usr/lib -L output/staging/lib -o output/target/usr/bin/ewfver ../ditt/ewfver.c -lewf -lz -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/hashver ../ditt/hashver.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/diskwipe ../ditt/diskwipe.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/logcase ../ditt/logcase.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/partab ../ditt/partab.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/partcmp ../ditt/partcmp.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/seccmp ../ditt/seccmp.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/sechash ../ditt/sechash.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/splitver ../ditt/splitver.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/wipechk ../ditt/wipechk.c -lpthread
+output/host/usr/bin/x86_64-buildroot-linux-uclibc-gcc -o output/target/usr/bin/zoneprof ../ditt/zoneprof.c -lpthread
 
 
 #Add this dir to filesystem
@@ -1,33 +1,30 @@
 #!/bin/sh
 #
-# verify <evidence dir> <evidence file no extension> <hash>
+# verify <evidence dir> <evidence file no extension> [<hash>]
 # last edit 17/06/2013 - Lee Tobin
-
-function evidenceVerifyFeed() {
-	totlen=$(du -c $1.* | tail -n 1 | grep -o "[0-9]*")
-	runlen=0
-
-	for inp in $1.*
-	do
-	#  flen=$(du $inp | grep -o "[0-9]*" | head -n 1)
-  	#runlen=$(($flen + $runlen))
-  	#displayStrings "" "" "$(( $runlen / ( $totlen / 100 ) ))%"
-  		cat $inp
-	done
-}
+#
+# splitver reads the split=256M segments with several threads and
+# checks the whole image against the Total in hashlog.log (or <hash>
+# if given) and each segment against its hashwindow= digest, naming
+# the bad segment in verify.log if there is one.
 
 function verifyImage() {
 	stty intr '^['
 	trap 'echo "Trapped"; stty intr "" ;exit 1' INT
 
-	evidenceVerifyFeed $1/$2 | md5sum > verify.res
-	read hash <verify.res
-	if [ "$hash"="$3" ] ; then
+	if [ -n "$3" ] ; then
+		total="-total $3"
+	else
+		total=""
+	fi
+	splitver "$1/$2" "$1/hashlog.log" $total -log_name "$1/verify.log" > verify.res
+	if [ $? -eq 0 ] ; then
    	stty intr ''
    	echo "COMPLETE"
    	exit 0
 	else
    	stty intr ''
+   	grep -i "segment\|Total" "$1/verify.log" | tail -n 4 >&2
    	echo "ERROR"
    	exit 1;
 	fi
@@ -98,24 +98,28 @@ then
 					else
 							clearDisplay
 							displayStrings "Verifying image"
-							if [ "$IMAGING_TOOL_SUITE" = "ewfacquire" ]; then
-								echo "Verification with ewfsuite disabled because "
-								echo "1. ewfverify runs out of memory on FIREBrick, and"
-								echo "2. EnCase will verify the image when it is added to a case"
-							else 
-								exitCode=$(verifyImage $destDir $evidenceID)
-								echo "Verification exit code is -->$exitCode<--"
-								if [[ "$exitCode" == "ERROR" ]]; then
-									clearDisplay
-									displayStrings "Verification falied" "Deleting image"
-					   			rm -r $destDir/*
-					   			rmdir $destDir
-								else
-									clearDisplay
-					   			displayStrings "Verification Success"
-					   			sleep 1
-								fi    
-							fi
+							exitCode=$(verifyImage $destDir $evidenceID)
+							echo "Verification exit code is -->$exitCode<--"
+							# ewfver is not yet proven on real E01 images, so an
+							# ewfacquire image is never deleted on its say so
+							if [[ "$exitCode" == "ERROR" && "$IMAGING_TOOL_SUITE" != "ewfacquire" ]]; then
+								clearDisplay
+								displayStrings "Verification falied" "Deleting image"
+				   			rm -r $destDir/*
+				   			rmdir $destDir
+							elif [[ "$exitCode" == "ERROR" ]]; then
+								clearDisplay
+								displayStrings "Verification falied" "Image kept"
+				   			sleep 2
+							elif [[ "$exitCode" == "UNVERIFIED" ]]; then
+								clearDisplay
+								displayStrings "Not verified" "Image kept"
+				   			sleep 2
+							else
+								clearDisplay
+				   			displayStrings "Verification Success"
+				   			sleep 1
+							fi    
 					fi
 					clearDisplay
 					;;
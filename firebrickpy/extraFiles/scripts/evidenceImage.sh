@@ -20,7 +20,7 @@ function performEvidenceImage() {
 	#dcfldd if=/dev/$evidenceDisk conv=noerror statusinterval=2048 hash=md5 split=256M of="$2/$3" hashlog="$2/hashlog.log" 2>&1 | tr -d "()ocwriten." | lcd j 0 3
 
 	if [ "$IMAGING_TOOL_SUITE" = "dcfldd" ]; then
-		dcfldd if=/dev/$evidenceDisk conv=noerror statusinterval=2048 hash=md5 split=256M of="$2/$3" hashlog="$2/hashlog.log" 2>&1 | tr -d "()ocwriten."
+		dcfldd if=/dev/$evidenceDisk conv=noerror statusinterval=2048 hash=md5 hashwindow=256M split=256M of="$2/$3" hashlog="$2/hashlog.log" 2>&1 | tr -d "()ocwriten."
 		imghash=$(tail -n 1 "$2/hashlog.log" | grep -o "[0-9a-f]*" | tail -n 1)
 	elif [ "$IMAGING_TOOL_SUITE" = "ewfacquire" ]; then
 		ewfacquire -t "$2/$3" -u -S 640MiB /dev/$evidenceDisk > $2/$3.log
@@ -1,9 +1,32 @@
 #!/bin/sh
 #
-# verify <evidence dir> <evidence file no extension> <hash>
+# verify <evidence dir> <evidence file no extension> [<hash>]
 # last edit 17/06/2013 - Lee Tobin
+#
+# ewfver checks every chunk checksum and the MD5 and SHA-1 stored
+# in the image, in a fixed amount of memory (ewfverify runs out of
+# memory on FIREBrick), naming any bad chunks in verify.log.
+# Prints COMPLETE, ERROR only when ewfver shows a checksum or digest
+# differs (exit 1), and UNVERIFIED when no answer was had: ewfver
+# missing, the image could not be opened or read, or no digest stored.
 
 function verifyImage() {
-	ewfverify $1/$2.E01 > $1/$2.verify.log
-	echo "COMPLETE"
+	stty intr '^['
+	trap 'echo "Trapped"; stty intr "" ;exit 1' INT
+
+	ewfver "$1/$2.E01" -log_name "$1/verify.log" > $1/$2.verify.log 2>&1
+	status=$?
+	stty intr ''
+	if [ $status -eq 0 ] ; then
+   	echo "COMPLETE"
+   	exit 0
+	elif [ $status -eq 1 ] ; then
+   	grep -i "chunk\|MD5\|SHA1\|verif" "$1/verify.log" | tail -n 4 >&2
+   	echo "ERROR"
+   	exit 1;
+	else
+   	echo "ewfver exit status $status" >&2
+   	echo "UNVERIFIED"
+   	exit 1;
+	fi
 }
@@ -14,7 +14,10 @@ initSingleDiskStorage() {
 		clearDisplay
 		if [ "$ZERO_STORAGE_DRIVE_ON_INITIALISE" == "true" ]; then
 			displayStrings "Zeroing Storage... (This might take a long time)"
-			dd if=/dev/zero of=${storageDisk} bs=1M
+			# let the drive zero itself where it can, dd if diskwipe can't do it
+			diskwipe storage firebrick init ${storageDisk} 00 -zero -noask -new_log \
+				-comment "storage initialise" -log_name /tmp/storagezerolog.txt > /dev/null ||
+				dd if=/dev/zero of=${storageDisk} bs=1M
 		fi		
 		displayStrings "Initialising Storage..." 
 		#create a new partition